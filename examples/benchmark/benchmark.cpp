@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Particle.h"
+#include "location.h"
+#include "location_modem_sim.h"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+
+SYSTEM_MODE(SEMI_AUTOMATIC);
+SYSTEM_THREAD(ENABLED);
+
+SerialLogHandler logHandler(LOG_LEVEL_INFO);
+
+constexpr int BENCHMARK_ITERATIONS {1000};
+constexpr int BENCHMARK_ACQUISITIONS {10};     // End-to-end acquisitions per TTFF distribution
+const char* const BENCHMARK_XTRA_FILE = "UFS:xtra2.bin";
+
+// Responses captured from BG95-M5 modems during acquisitions
+const char* const qlocCorpus[] = {
+    "+QGPSLOC: 170411.000,37.78583,-122.40641,1.3,12.2,3,218.21,0.0,0.0,210524,09",
+    "+QGPSLOC: 170412.000,37.78584,-122.40642,1.1,12.6,3,218.21,0.4,0.2,210524,10",
+    "+QGPSLOC: 003259.000,-33.86882,151.20929,0.8,38.9,3,095.47,41.2,22.2,010624,14",
+    "+QGPSLOC: 091502.000,51.50735,-0.12776,2.4,17.0,2,000.00,0.0,0.0,150324,05",
+    "+QGPSLOC: 235959.000,64.14660,-21.94260,0.7,45.3,3,311.06,97.1,52.4,311223,18",
+    "+QGPSLOC: 120000.000,-0.00012,-78.46783,4.8,2850.0,2,180.00,3.6,1.9,290224,04",
+};
+
+const char* const epeCorpus[] = {
+    R"(+QGPSCFG: "estimation_error",3.2,4.8,0.1,1.9)",
+    R"(+QGPSCFG: "estimation_error",12.5,18.0,0.6,7.4)",
+    R"(+QGPSCFG: "estimation_error",48.1,71.3,2.2,26.0)",
+    "+CME ERROR: 516",
+};
+
+const char* const cmeCorpus[] = {
+    "+CME ERROR: 516",
+    "+CME ERROR: 505",
+    "+CME ERROR: 504",
+    "+CME ERROR: 549",
+    "+QGPSLOC: 170411.000,37.78583,-122.40641,1.3,12.2,3,218.21,0.0,0.0,210524,09",
+};
+
+const LocationPoint publishCorpus[] = {
+    {3, 1716311051, 1716311051, LocationCoordinateTraits::fromE7(377858300), LocationCoordinateTraits::fromE7(-1224064100),
+     12.2f, 0.0f, 218.35f, 3.2f, 1.3f, 4.8f, 0.0f, 12.4f, 9, LocationStartType::Warm},
+    {3, 1717201979, 1717201979, LocationCoordinateTraits::fromE7(-338688200), LocationCoordinateTraits::fromE7(1512092900),
+     38.9f, 11.4f, 95.78f, 12.5f, 0.8f, 18.0f, 0.0f, 3.1f, 14, LocationStartType::Hot},
+};
+
+// Time to first fix distribution of simulated acquisitions, log-normal and clamped to the given range
+struct TtffDistribution {
+    const char* name;
+    double medianMs;
+    double sigma;
+    uint32_t minimumMs;
+    uint32_t maximumMs;
+};
+
+// Typical BG95-M5 start types under open sky, pass other distributions to runAcquisitionBenchmarks() to model a site
+const TtffDistribution defaultTtffDistributions[] = {
+    {"hot", 2000.0, 0.3, 1000, 5000},
+    {"warm", 12000.0, 0.4, 5000, 30000},
+    {"cold", 32000.0, 0.3, 20000, 60000},
+};
+
+// Exposes library internals to the benchmark through the friend declaration in SomLocation
+class LocationBenchmark {
+public:
+    static CME_Error parseQlocResponse(const char* buf, LocationPoint& point) {
+        SomLocation::QlocContext context {};
+        return Location.parseQlocResponse(buf, context, point);
+    }
+
+    static void parseEpeResponse(const char* buf, LocationPoint& point) {
+        SomLocation::EpeContext context {};
+        Location.parseEpeResponse(buf, context, point);
+    }
+
+    static CME_Error parseCmeError(const char* buf) {
+        return Location.parseCmeError(buf);
+    }
+
+    static size_t buildPublish(char* buffer, size_t len, const LocationPoint& point) {
+        return Location.buildPublish(buffer, len, point, 1);
+    }
+
+    static size_t buildPublishPacked(char* buffer, size_t len, const LocationPoint& point) {
+        return Location.buildPublishPacked(buffer, len, point, 1);
+    }
+};
+
+struct ReferenceQloc {
+    unsigned int tm_hour {};
+    unsigned int tm_min {};
+    unsigned int tm_sec {};
+    unsigned int tm_day {};
+    unsigned int tm_month {};
+    unsigned int tm_year {};
+    double latitude {};
+    double longitude {};
+    unsigned int fix {};
+    float hdop {};
+    float altitude {};
+    unsigned int cogDegrees {};
+    unsigned int cogMinutes {};
+    float speedKmph {};
+    float speedKnots {};
+    unsigned int nsat {};
+};
+
+// The sscanf() based parser previously used by the library
+int referenceParseQloc(const char* buf, ReferenceQloc& context) {
+    return sscanf(buf, " +QGPSLOC: %02u%02u%02u.%*03u,%lf,%lf,%f,%f,%u,%03u.%02u,%f,%f,%02u%02u%02u,%u",
+                  &context.tm_hour, &context.tm_min, &context.tm_sec,
+                  &context.latitude, &context.longitude, &context.hdop, &context.altitude,
+                  &context.fix, &context.cogDegrees, &context.cogMinutes, &context.speedKmph, &context.speedKnots,
+                  &context.tm_day, &context.tm_month, &context.tm_year,
+                  &context.nsat);
+}
+
+template <typename C, typename F>
+double measureMicroseconds(const C& corpus, F func) {
+    auto start = System.ticks();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        for (auto& entry : corpus) {
+            func(entry);
+        }
+    }
+    auto elapsed = System.ticks() - start;
+    return (double)elapsed / System.ticksPerMicrosecond() / (BENCHMARK_ITERATIONS * std::size(corpus));
+}
+
+void report(const char* name, double us) {
+    // One JSON object per line so results can be collected and compared between library versions
+    Log.info("{\"bench\":\"%s\",\"us_per_op\":%.3f,\"iterations\":%d}", name, us, BENCHMARK_ITERATIONS);
+}
+
+void runBenchmarks() {
+    volatile int sink = 0;
+
+    report("qloc_sscanf", measureMicroseconds(qlocCorpus, [&](const char* line) {
+        ReferenceQloc context {};
+        sink = sink + referenceParseQloc(line, context);
+    }));
+
+    report("qloc_tokenizer", measureMicroseconds(qlocCorpus, [&](const char* line) {
+        LocationQloc qloc;
+        sink = sink + LocationParser::parseQloc(line, qloc) + (int)qloc.present;
+    }));
+
+    report("epoch_mktime", measureMicroseconds(qlocCorpus, [&](const char*) {
+        std::tm timeinfo = {};
+        timeinfo.tm_year = 2024 - 1900;
+        timeinfo.tm_mon = 4;
+        timeinfo.tm_mday = 21 + (sink & 0x7);
+        timeinfo.tm_hour = 17;
+        timeinfo.tm_min = 4;
+        timeinfo.tm_sec = 11;
+        sink = sink + (int)std::mktime(&timeinfo);
+    }));
+
+    report("epoch_days_from_civil", measureMicroseconds(qlocCorpus, [&](const char*) {
+        sink = sink + (int)LocationTime::epochFromUtc(2024, 5, 21 + (sink & 0x7), 17, 4, 11);
+    }));
+
+    report("qloc_response", measureMicroseconds(qlocCorpus, [&](const char* line) {
+        LocationPoint point {};
+        sink = sink + (int)LocationBenchmark::parseQlocResponse(line, point) + point.satsInUse;
+    }));
+
+    report("epe_response", measureMicroseconds(epeCorpus, [&](const char* line) {
+        LocationPoint point {};
+        LocationBenchmark::parseEpeResponse(line, point);
+        sink = sink + (int)point.horizontalAccuracy;
+    }));
+
+    report("cme_error", measureMicroseconds(cmeCorpus, [&](const char* line) {
+        sink = sink + (int)LocationBenchmark::parseCmeError(line);
+    }));
+
+    static char publishBuffer[particle::protocol::MAX_EVENT_DATA_LENGTH];
+    report("build_publish", measureMicroseconds(publishCorpus, [&](const LocationPoint& point) {
+        sink = sink + (int)LocationBenchmark::buildPublish(publishBuffer, sizeof(publishBuffer), point);
+    }));
+
+    report("build_publish_packed", measureMicroseconds(publishCorpus, [&](const LocationPoint& point) {
+        sink = sink + (int)LocationBenchmark::buildPublishPacked(publishBuffer, sizeof(publishBuffer), point);
+    }));
+
+    for (auto& point : publishCorpus) {
+        Log.info("{\"size\":\"publish\",\"json\":%u,\"packed\":%u}",
+                 (unsigned int)LocationBenchmark::buildPublish(publishBuffer, sizeof(publishBuffer), point),
+                 (unsigned int)LocationBenchmark::buildPublishPacked(publishBuffer, sizeof(publishBuffer), point));
+    }
+
+    // A walking pace 1 Hz track, about 1.5 m between points
+    constexpr size_t TRACK_POINTS {64};
+    static uint8_t trackBuffer[TRACK_POINTS * 16];
+    LocationTrackEncoder track;
+    auto encodeTrack = [&](unsigned int precision, LocationTrackFormat format) {
+        track.begin(trackBuffer, sizeof(trackBuffer), precision, format, true);
+        for (size_t i = 0; i < TRACK_POINTS; i++) {
+            track.add(377858300 + (int32_t)(i * 11), -1224064100 - (int32_t)(i * 9 + (i & 3)), 1716311051 + i);
+        }
+    };
+    int trackCorpus[] = {0};
+    report("track_encode_64", measureMicroseconds(trackCorpus, [&](int) {
+        encodeTrack(7, LocationTrackFormat::Binary);
+        sink = sink + (int)track.size();
+    }));
+
+    for (auto format : {LocationTrackFormat::Binary, LocationTrackFormat::Text}) {
+        for (auto precision : {5u, 7u}) {
+            encodeTrack(precision, format);
+            Log.info("{\"size\":\"track\",\"format\":\"%s\",\"precision\":%u,\"points\":%u,\"bytes\":%u}",
+                     (LocationTrackFormat::Text == format) ? "text" : "binary", precision, (unsigned int)track.count(),
+                     (unsigned int)track.size());
+        }
+    }
+}
+
+uint64_t simulationClock() {
+    return System.millis();
+}
+
+uint32_t percentile(std::vector<uint32_t> samples, int percent) {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[(samples.size() - 1) * percent / 100];
+}
+
+// Acquire against a simulated BG95 whose first fix arrives at a time drawn from the distribution
+void runAcquisitions(LocationSimulatedModem& modem, std::mt19937& random, const TtffDistribution& distribution,
+                     const char* name) {
+    std::lognormal_distribution<double> ttff(std::log(distribution.medianMs), distribution.sigma);
+    std::vector<uint32_t> ttffSamples;
+    std::vector<uint32_t> totalSamples;
+    unsigned int fixed = 0;
+    unsigned int commands = 0;
+
+    for (int run = 0; run < BENCHMARK_ACQUISITIONS; run++) {
+        auto firstFixMs = std::min(std::max((uint32_t)ttff(random), distribution.minimumMs), distribution.maximumMs);
+        const LocationSimulatedStep steps[] = {
+            {firstFixMs, qlocCorpus[0], epeCorpus[0]},
+        };
+        LocationSimulatedScenario scenario {name, steps, std::size(steps)};
+        modem.scenario(scenario);
+
+        LocationPoint point {};
+        auto startCommands = modem.commands();
+        auto start = System.millis();
+        auto result = Location.getLocation(point);
+        auto total = (uint32_t)(System.millis() - start);
+        commands += modem.commands() - startCommands;
+
+        LocationTiming timing {};
+        Location.getLastTiming(timing);
+        Log.info("{\"acquire\":\"%s\",\"run\":%d,\"result\":%d,\"start\":%d,\"assisted\":%d,\"ttff_sim_ms\":%lu,"
+                 "\"ttff_ms\":%lu,\"total_ms\":%lu,\"polls\":%u,\"poll_max_ms\":%lu,\"settle_ms\":%lu}",
+                 name, run, (int)result, (int)point.startType, (int)modem.assisted(), (unsigned long)firstFixMs,
+                 (unsigned long)(point.timeToFirstFix * 1000.0f), (unsigned long)total, timing.polls,
+                 (unsigned long)timing.pollMaximumMs, (unsigned long)timing.settleMs);
+        if (LocationResults::Fixed == result) {
+            fixed++;
+            ttffSamples.push_back((uint32_t)(point.timeToFirstFix * 1000.0f));
+            totalSamples.push_back(total);
+        }
+    }
+
+    Log.info("{\"bench\":\"acquire_%s\",\"runs\":%d,\"fixed\":%u,\"ttff_p50_ms\":%lu,\"ttff_p90_ms\":%lu,"
+             "\"total_p50_ms\":%lu,\"total_p90_ms\":%lu,\"commands_per_run\":%.1f}",
+             name, BENCHMARK_ACQUISITIONS, fixed,
+             (unsigned long)percentile(ttffSamples, 50), (unsigned long)percentile(ttffSamples, 90),
+             (unsigned long)percentile(totalSamples, 50), (unsigned long)percentile(totalSamples, 90),
+             (double)commands / BENCHMARK_ACQUISITIONS);
+}
+
+// Run each distribution, then the assisted one again with XTRA data loaded
+void runAcquisitionBenchmarks(const TtffDistribution* distributions, size_t count, const TtffDistribution& assisted) {
+    static LocationSimulatedModem modem(simulationClock);
+    std::mt19937 random(BENCHMARK_ACQUISITIONS);  // Fixed seed so that runs are comparable between versions
+
+    // Location is a singleton, so the simulator replaces the cellular modem until the benchmark is done
+    LocationConfiguration config;
+    Location.begin(config, modem);
+
+    for (size_t i = 0; i < count; i++) {
+        runAcquisitions(modem, random, distributions[i], distributions[i].name);
+    }
+
+    // The time injection that makes XTRA data usable needs a valid system time
+    if (Time.isValid()) {
+        modem.assistanceFile(BENCHMARK_XTRA_FILE);
+        config.assistance(true);
+        Location.begin(config, modem);
+        Location.injectAssistance(BENCHMARK_XTRA_FILE);
+        runAcquisitions(modem, random, assisted, "cold_xtra");
+        config.assistance(false);
+    }
+    else {
+        Log.warn("{\"skip\":\"acquire_cold_xtra\",\"reason\":\"time not valid\"}");
+    }
+
+    Location.begin(config, Location.cellularModem());
+}
+
+void setup() {
+    waitFor(Serial.isConnected, 10000);
+    runBenchmarks();
+}
+
+void loop() {
+    if (!Serial.available()) {
+        return;
+    }
+
+    switch ((char)Serial.read()) {
+        case 'b':
+            runBenchmarks();
+            break;
+
+        case 'a':
+            // Takes several minutes since simulated acquisitions run in real time
+            runAcquisitionBenchmarks(defaultTtffDistributions, std::size(defaultTtffDistributions),
+                                     defaultTtffDistributions[std::size(defaultTtffDistributions) - 1]);
+            break;
+    }
+}
@@ -54,7 +54,8 @@ void loop() {
                 auto fixed = (point.fix) ? true : false;
                 if (fixed) {
                     Log.info("Position fixed!");
-                    Log.info("Lat %0.5lf, lon %0.5lf", point.latitude, point.longitude);
+                    Log.info("Lat %0.5lf, lon %0.5lf", LocationCoordinateTraits::toDegrees(point.latitude),
+                        LocationCoordinateTraits::toDegrees(point.longitude));
                     Log.info("Alt %0.1f m, speed %0.1f m/s, heading %0.1f deg", point.altitude, point.speed, point.heading);
                 }
                 else {
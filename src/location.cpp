@@ -30,14 +30,72 @@ constexpr system_tick_t LOCATION_INACTIVE_PERIOD_SUCCESS_MS {120 * 1000};
 constexpr system_tick_t LOCATION_PERIOD_ACQUIRE_MS {1 * 1000};
 constexpr system_tick_t ANTENNA_POWER_SETTLING_MS {100};
 constexpr int LOCATION_REQUIRED_SETTLING_COUNT {2};  // Number of consecutive fixes
+constexpr int64_t LOCATION_HOT_START_SECONDS {2 * 60 * 60};       // Broadcast ephemeris stays current
+constexpr int64_t LOCATION_WARM_START_SECONDS {7 * 24 * 60 * 60};  // Almanac and last position remain useful
+const char* const LOCATION_START_NAMES[] = {nullptr, "hot", "warm", "cold"};
+constexpr size_t LOCATION_COMMAND_QUEUE_DEPTH {4};
+constexpr system_tick_t LOCATION_NMEA_WAIT_MS {5 * 1000};
+constexpr system_tick_t LOCATION_NMEA_FALLBACK_MS {2 * LOCATION_NMEA_WAIT_MS};  // Silence before polling instead
+const char* const LOCATION_NMEA_URC_PREFIXES[] = {"$G", "$BD"};
+#ifndef LOCATION_STORE_DIRECTORY
+#define LOCATION_STORE_DIRECTORY "/usr/location"  // Directory of the offline store and reference position
+#endif // LOCATION_STORE_DIRECTORY
+constexpr unsigned int LOCATION_STORE_COMMIT_INTERVAL {16};  // Replayed fixes between writes of the replay position
+constexpr unsigned int LOCATION_ASSISTANCE_TIME_UNCERTAINTY_MS {3500};
+constexpr system_tick_t LOCATION_REFERENCE_SAVE_MS {15 * 60 * 1000};  // Reference writes while tracking
+constexpr system_tick_t LOCATION_ASSISTANCE_RETRY_MS {30 * 1000};            // First retry after XTRA cannot be enabled
+constexpr system_tick_t LOCATION_ASSISTANCE_RETRY_MAXIMUM_MS {60 * 60 * 1000};  // Retries double up to this interval
 
 Logger locationLog("loc");
 
 SomLocation *SomLocation::_instance = nullptr;
 
+namespace {
+
+class LocationJsonWriter : public JSONBufferWriter {
+public:
+    LocationJsonWriter(char* buffer, size_t size) : JSONBufferWriter(buffer, size) {
+    }
+
+    // Write a coordinate in 1e-7 degrees as a JSON number using integer arithmetic only
+    LocationJsonWriter& coordinateValue(int32_t e7) {
+        auto magnitude = (0 > e7) ? -(uint32_t)e7 : (uint32_t)e7;
+        auto whole = (int)(magnitude / 10000000);
+        auto fraction = magnitude % 10000000;
+
+        if ((0 > e7) && (0 == whole)) {
+            value(-0.0, 0);  // Keep the sign of values between -1 and 0 degrees
+        }
+        else {
+            value((0 > e7) ? -whole : whole);
+        }
+
+        char digits[8] = {'.'};
+        for (int i = 7; i > 0; i--) {
+            digits[i] = '0' + (fraction % 10);
+            fraction /= 10;
+        }
+        write(digits, sizeof(digits));
+        return *this;
+    }
+};
+
+// Scale and round a non-negative value into a 16 bit field, saturating at the field limits
+uint16_t packUnsigned16(float value, float scale) {
+    auto scaled = value * scale + 0.5f;
+    if (0.0f >= scaled) {
+        return 0;
+    }
+    return (65535.0f <= scaled) ? 65535 : (uint16_t)scaled;
+}
+
+} // anonymous namespace
+
 SomLocation::SomLocation() {
-    os_queue_create(&_commandQueue, sizeof(LocationCommandContext), 1, nullptr);
-    os_queue_create(&_responseQueue, sizeof(LocationResults), 1, nullptr);
+    os_queue_create(&_commandQueue, sizeof(LocationCommandContext), LOCATION_COMMAND_QUEUE_DEPTH, nullptr);
+    os_queue_create(&_nmeaQueue, sizeof(uint8_t), 1, nullptr);
+    os_queue_create(&_cancelQueue, sizeof(uint8_t), 1, nullptr);
+    _batch.begin(_batchBuffer, sizeof(_batchBuffer));
     _thread = new Thread("gnss_cellular", [this]() {SomLocation::threadLoop();}, OS_THREAD_PRIORITY_DEFAULT);
 }
 
@@ -45,30 +103,21 @@ bool SomLocation::detectModemType() {
     bool detected = false;
 
     if (modemNotDetected() && isModemOn()) {
-        CellularDevice celldev = {};
-        cellular_device_info(&celldev, nullptr);
-        locationLog.trace("Modem ID is %d", celldev.dev);
-        switch (celldev.dev) {
-          case 0:
+        switch (_modem->device()) {
+          case LocationModemDevice::Unknown:
             locationLog.trace("Modem not cached yet");
             // Do not set modem type
             break;
 
-          case DEV_QUECTEL_BG95_M5:
+          case LocationModemDevice::Bg95M5:
             _modemType = _ModemType::BG95_M5;
             locationLog.trace("BG95-M5 detected");
             detected = true;
             break;
 
-        //   case DEV_QUECTEL_EG91_EX:
-        //     _modemType = _ModemType::EG91;
-        //     locationLog.trace("EG91-EX detected");
-        //     detected = true;
-        //     break;
-
           default:
             _modemType = _ModemType::Unsupported;
-            locationLog.trace("Modem type %d not supported", celldev.dev);
+            locationLog.trace("Modem type not supported");
             break;
         }
     }
@@ -111,19 +160,44 @@ int SomLocation::setConstellationBg95(LocationConstellation flags) {
 
     char command[64] = {};
     sprintf(command, "AT+QGPSCFG=\"gnssconfig\",%d", configNumber);
-    Cellular.command(command);
+    atCommand(LocationAtCommand::Configure, command);
     return 0;
 }
 
+int SomLocation::begin(LocationConfiguration& configuration, LocationModem& modem) {
+    if (&modem != _modem) {
+        _modem = &modem;
+        _modemType = _ModemType::Unavailable;
+        _nmeaUrcRegistered = false;
+        _nmeaUnavailable = false;
+    }
+    return begin(configuration);
+}
+
 int SomLocation::begin(LocationConfiguration& configuration) {
     locationLog.info("Beginning location library");
     _conf = configuration;
+    _assistanceConfigured = false;
+    _assistanceRetry = 0;
+    _assistanceBackoff = 0;
     _antennaPowerPin = _conf.enableAntennaPower();
     if (PIN_INVALID != _antennaPowerPin) {
         locationLog.info("Configuring antenna pin");
         pinMode(_antennaPowerPin, OUTPUT);
     }
 
+    {
+        const std::lock_guard<Mutex> lock(_publishMutex);
+        _store.end();
+        if (_conf.storeOfflineSlots() && _store.begin(LOCATION_STORE_DIRECTORY, _conf.storeOfflineSlots())) {
+            locationLog.error("Unable to open offline fix store");
+        }
+    }
+
+    if (_conf.reference()) {
+        loadReference();
+    }
+
     if (isModemOn() && modemNotDetected()) {
         locationLog.info("Detecting modem type");
         detectModemType();
@@ -149,24 +223,39 @@ LocationResults SomLocation::getLocation(LocationPoint& point, bool publish) {
         }
     }
 
-    // Check if already running
-    if (_acquiring.load()) {
-        locationLog.trace("Aquisition is already underway");
-        return LocationResults::Pending;
+    // Serve the latest fix of a tracking session without waiting
+    if (readTrackedPoint(point)) {
+        if (publish) {
+            publishLocation(point);
+        }
+        return LocationResults::Fixed;
     }
+
     locationLog.trace("Starting synchronous aquisition");
-    LocationCommandContext event {};
-    event.command = LocationCommand::Acquire;
-    event.point = &point;
-    event.sendResponse = true;
-    os_queue_put(_commandQueue, &event, 0, nullptr);
-    auto result = waitOnResponseEvent((system_tick_t)_conf.maximumFixTime() * 1000 + LOCATION_PERIOD_ACQUIRE_MS);
-    if (publish && (LocationResults::Fixed == result) && isConnected()) {
-        locationLog.info("Publishing loc event");
-        buildPublish(_publishBuffer, sizeof(_publishBuffer), point, _reqid);
-        auto published = Particle.publish("loc", _publishBuffer);
-        if (published) {
-            _reqid++;
+    os_semaphore_t done = nullptr;
+    if (os_semaphore_create(&done, 1, 0)) {
+        return LocationResults::Pending;
+    }
+    SCOPE_GUARD({
+        os_semaphore_destroy(done);
+    });
+
+    LocationWaiter waiter {};
+    LocationResults result {LocationResults::TimedOut};
+    waiter.point = &point;
+    waiter.publish = publish;
+    waiter.result = &result;
+    waiter.done = done;
+    auto waiterIndex = addWaiter(waiter);
+    if (0 > waiterIndex) {
+        locationLog.trace("Too many waiters for the aquisition underway");
+        return LocationResults::Pending;
+    }
+
+    if (os_semaphore_take(done, (system_tick_t)_conf.maximumFixTime() * 1000 + LOCATION_PERIOD_ACQUIRE_MS, false)) {
+        // Completion may have already claimed the waiter, in which case it is about to signal
+        if (!removeWaiter(waiterIndex, done)) {
+            os_semaphore_take(done, CONCURRENT_WAIT_FOREVER, false);
         }
     }
     return result;
@@ -185,37 +274,363 @@ LocationResults SomLocation::getLocation(LocationPoint& point, LocationDone call
         }
     }
 
-    // Check if already running
-    if (_acquiring.load()) {
-        locationLog.trace("Aquisition is already underway");
-        return LocationResults::Pending;
+    // Serve the latest fix of a tracking session without waiting
+    if (readTrackedPoint(point)) {
+        if (publish) {
+            publishLocation(point);
+        }
+        if (callback) {
+            callback(LocationResults::Fixed);
+        }
+        return LocationResults::Fixed;
     }
+
     locationLog.trace("Starting asynchronous aquisition");
+    LocationWaiter waiter {};
+    waiter.point = &point;
+    waiter.callback = callback;
+    waiter.publish = publish;
+    if (0 > addWaiter(waiter)) {
+        locationLog.trace("Too many waiters for the aquisition underway");
+        return LocationResults::Pending;
+    }
+    return LocationResults::Acquiring;
+}
+
+int SomLocation::addWaiter(const LocationWaiter& waiter) {
+    const std::lock_guard<Mutex> lock(_waiterMutex);
+
+    int index = -1;
+    for (size_t i = 0; i < LOCATION_MAX_WAITERS; i++) {
+        if (!_waiters[i].point) {
+            index = (int)i;
+            break;
+        }
+    }
+    if (0 > index) {
+        return -1;
+    }
+
+    // The first waiter starts the acquisition, later ones join it
+    if (!_acquiring.load()) {
+        // Flag the acquisition before queueing it, the thread drops Acquire commands that find the flag clear
+        _acquiring.store(true);
+        LocationCommandContext event {};
+        event.command = LocationCommand::Acquire;
+        if (os_queue_put(_commandQueue, &event, 0, nullptr)) {
+            _acquiring.store(false);
+            return -1;
+        }
+    }
+    else {
+        locationLog.trace("Joining aquisition underway");
+    }
+
+    _waiters[index] = waiter;
+    return index;
+}
+
+bool SomLocation::removeWaiter(int index, os_semaphore_t done) {
+    const std::lock_guard<Mutex> lock(_waiterMutex);
+
+    if ((0 > index) || (LOCATION_MAX_WAITERS <= (size_t)index) || (done != _waiters[index].done)) {
+        return false;
+    }
+    _waiters[index] = {};
+    return true;
+}
+
+bool SomLocation::completeWaiters(LocationResults response, const LocationPoint& point) {
+    LocationWaiter waiters[LOCATION_MAX_WAITERS];
+    {
+        const std::lock_guard<Mutex> lock(_waiterMutex);
+        for (size_t i = 0; i < LOCATION_MAX_WAITERS; i++) {
+            waiters[i] = _waiters[i];
+            _waiters[i] = {};
+        }
+        _acquiring.store(false);
+    }
+
+    // Every waiter gets its own copy of the same result before anyone is notified
+    bool publish = false;
+    for (auto& waiter : waiters) {
+        if (waiter.point) {
+            *waiter.point = point;
+            publish = publish || waiter.publish;
+        }
+    }
+    publish = publish && (LocationResults::Fixed == response);
+    if (publish) {
+        publishLocation(point);
+    }
+
+    for (auto& waiter : waiters) {
+        if (!waiter.point) {
+            continue;
+        }
+        if (waiter.done) {
+            locationLog.trace("Sending synchronous completion");
+            *waiter.result = response;
+            os_semaphore_give(waiter.done, false);
+        }
+        else if (waiter.callback) {
+            locationLog.trace("Sending asynchronous completion");
+            waiter.callback(response);
+        }
+    }
+
+    return publish;
+}
+
+LocationResults SomLocation::getLocation(LocationPoint& point, std::chrono::milliseconds maximumAge, bool publish) {
+    if (readLastFix(point, maximumAge)) {
+        locationLog.trace("Using cached position");
+        if (publish) {
+            publishLocation(point);
+        }
+        return LocationResults::Fixed;
+    }
+
+    return getLocation(point, publish);
+}
+
+LocationResults SomLocation::getLocation(LocationPoint& point, std::chrono::milliseconds maximumAge, LocationDone callback, bool publish) {
+    if (readLastFix(point, maximumAge)) {
+        locationLog.trace("Using cached position");
+        if (publish) {
+            publishLocation(point);
+        }
+        if (callback) {
+            callback(LocationResults::Fixed);
+        }
+        return LocationResults::Fixed;
+    }
+
+    return getLocation(point, callback, publish);
+}
+
+bool SomLocation::getLastLocation(LocationPoint& point, system_tick_t* age) {
+    const std::lock_guard<Mutex> lock(_lastFixMutex);
+    if (!_lastFixValid) {
+        return false;
+    }
+    point = _lastFix;
+    if (age) {
+        *age = (system_tick_t)(System.millis() - _lastFixMillis);
+    }
+    return true;
+}
+
+bool SomLocation::getLastTiming(LocationTiming& timing) {
+    const std::lock_guard<Mutex> lock(_timingMutex);
+    if (!_lastTimingValid) {
+        return false;
+    }
+    timing = _lastTiming;
+    return true;
+}
+
+void SomLocation::recordPoll(uint64_t sent) {
+    auto latency = (uint32_t)(System.millis() - sent);
+    auto& timing = _sessionTiming;
+    timing.pollLastMs = latency;
+    timing.pollMinimumMs = (0 == timing.polls) ? latency : min(timing.pollMinimumMs, latency);
+    timing.pollMaximumMs = max(timing.pollMaximumMs, latency);
+    timing.pollTotalMs += latency;
+    timing.polls++;
+}
+
+void SomLocation::saveTiming() {
+    auto now = System.millis();
+    _sessionTiming.sessionMs = (uint32_t)(now - _sessionStart);
+    _sessionTiming.gnssPriorityMs = _rfScheduler.grantedMs(now);
+
+    const std::lock_guard<Mutex> lock(_timingMutex);
+    _lastTiming = _sessionTiming;
+    _lastTimingValid = true;
+}
+
+void SomLocation::saveLastFix(const LocationPoint& point) {
+    const std::lock_guard<Mutex> lock(_lastFixMutex);
+    _lastFix = point;
+    _lastFixMillis = System.millis();
+    _lastFixValid = true;
+    if (_conf.reference()) {
+        _referenceFix = point;
+        _referenceValid = true;
+        _referenceDirty = true;
+    }
+}
+
+bool SomLocation::getReferenceLocation(LocationPoint& point) {
+    const std::lock_guard<Mutex> lock(_lastFixMutex);
+    if (!_referenceValid) {
+        return false;
+    }
+    point = _referenceFix;
+    return true;
+}
+
+void SomLocation::loadReference() {
+    LocationPackedFix fix;
+    if (LocationStore::loadLast(LOCATION_STORE_DIRECTORY, fix) || !fix.locked) {
+        return;
+    }
+
+    const std::lock_guard<Mutex> lock(_lastFixMutex);
+    if (!_referenceValid) {
+        unpackFix(fix, _referenceFix);
+        _referenceValid = true;
+        locationLog.info("Restored reference position from %lu", (unsigned long)fix.epochTime);
+    }
+}
+
+void SomLocation::saveReference() {
+    LocationPackedFix fix;
+    {
+        const std::lock_guard<Mutex> lock(_lastFixMutex);
+        if (!_referenceDirty) {
+            return;
+        }
+        packFix(_referenceFix, 0, fix);
+        _referenceDirty = false;
+    }
+
+    // Written once per session, or periodically while tracking, rather than per fix to spare the flash
+    if (LocationStore::saveLast(LOCATION_STORE_DIRECTORY, fix)) {
+        locationLog.warn("Unable to save reference position");
+    }
+    _referenceSaved = System.millis();
+}
+
+bool SomLocation::readLastFix(LocationPoint& point, std::chrono::milliseconds maximumAge) {
+    const std::lock_guard<Mutex> lock(_lastFixMutex);
+    if (!_lastFixValid || (0 > maximumAge.count()) ||
+        ((System.millis() - _lastFixMillis) > (uint64_t)maximumAge.count())) {
+        return false;
+    }
+    point = _lastFix;
+    return true;
+}
+
+int SomLocation::startTracking(unsigned int intervalMs, bool publish) {
+    if (!isModemOn()) {
+        locationLog.trace("Modem is not on");
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    if (modemNotDetected() && !detectModemType()) {
+        locationLog.trace("Modem is not supported");
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    if (0 == intervalMs) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+
     LocationCommandContext event {};
-    event.command = LocationCommand::Acquire;
-    event.point = &point;
-    event.doneCallback = callback;
+    event.command = LocationCommand::StartTracking;
+    event.interval = intervalMs;
     event.publish = publish;
-    os_queue_put(_commandQueue, &event, 0, nullptr);
-    return LocationResults::Acquiring;
+    if (os_queue_put(_commandQueue, &event, 0, nullptr)) {
+        return SYSTEM_ERROR_BUSY;
+    }
+    return 0;
 }
 
-LocationCommandContext SomLocation::waitOnCommandEvent(system_tick_t timeout) {
-    LocationCommandContext event = {};
-    auto ret = os_queue_take(_commandQueue, &event, timeout, nullptr);
-    if (ret) {
-        event.command = LocationCommand::None;
-        event.point = nullptr;
+int SomLocation::stopTracking() {
+    LocationCommandContext event {};
+    event.command = LocationCommand::StopTracking;
+    if (os_queue_put(_commandQueue, &event, 0, nullptr)) {
+        return SYSTEM_ERROR_BUSY;
+    }
+    return 0;
+}
+
+int SomLocation::startDutyCycle(bool publish) {
+    if (!isModemOn()) {
+        locationLog.trace("Modem is not on");
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    if (modemNotDetected() && !detectModemType()) {
+        locationLog.trace("Modem is not supported");
+        return SYSTEM_ERROR_NOT_SUPPORTED;
     }
 
-    return event;
+    LocationCommandContext event {};
+    event.command = LocationCommand::StartDutyCycle;
+    event.publish = publish;
+    if (os_queue_put(_commandQueue, &event, 0, nullptr)) {
+        return SYSTEM_ERROR_BUSY;
+    }
+    return 0;
+}
+
+int SomLocation::stopDutyCycle() {
+    LocationCommandContext event {};
+    event.command = LocationCommand::StopDutyCycle;
+    if (os_queue_put(_commandQueue, &event, 0, nullptr)) {
+        return SYSTEM_ERROR_BUSY;
+    }
+    return 0;
+}
+
+int SomLocation::cancel() {
+    if (!_acquiring.load() && !_tracking.load()) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+
+    _cancel.store(true);
+
+    // Wake the acquisition loop whether it is between polls or waiting on NMEA output
+    uint8_t wake = 1;
+    os_queue_put(_cancelQueue, &wake, 0, nullptr);
+    os_queue_put(_nmeaQueue, &wake, 0, nullptr);
+    return 0;
+}
+
+int SomLocation::injectAssistance(const char* filename) {
+    if (!_conf.assistance()) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    if (!filename || ('\0' == filename[0]) || (sizeof(_assistanceFile) <= strlen(filename)) || strchr(filename, '"')) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+
+    const std::lock_guard<Mutex> lock(_assistanceMutex);
+    LocationCommandContext event {};
+    event.command = LocationCommand::InjectAssistance;
+    if (os_queue_put(_commandQueue, &event, 0, nullptr)) {
+        return SYSTEM_ERROR_BUSY;
+    }
+    strlcpy(_assistanceFile, filename, sizeof(_assistanceFile));
+    _assistancePending = true;
+    return 0;
+}
+
+bool SomLocation::getAssistance(LocationAssistance& assistance) {
+    const std::lock_guard<Mutex> lock(_assistanceMutex);
+    if (!_conf.assistance() || !_assistanceKnown) {
+        return false;
+    }
+    assistance = _assistance;
+    return true;
+}
+
+bool SomLocation::isAssistanceDue() {
+    const std::lock_guard<Mutex> lock(_assistanceMutex);
+    if (!_conf.assistance() || !_assistanceKnown || _assistancePending) {
+        return false;
+    }
+    if (0 == _assistance.expires) {
+        return true;
+    }
+    return Time.isValid() && ((Time.now() + (time_t)_conf.assistanceMargin() * 60) >= _assistance.expires);
 }
 
-LocationResults SomLocation::waitOnResponseEvent(system_tick_t timeout) {
-    LocationResults event = {LocationResults::Idle};
-    auto ret = os_queue_take(_responseQueue, &event, timeout, nullptr);
+LocationCommandContext SomLocation::waitOnCommandEvent(system_tick_t timeout) {
+    LocationCommandContext event = {};
+    auto ret = os_queue_take(_commandQueue, &event, timeout, nullptr);
     if (ret) {
-        event = LocationResults::Idle;
+        event.command = LocationCommand::None;
     }
 
     return event;
@@ -240,38 +655,70 @@ void SomLocation::stripLfCr(char* str) {
     *write = '\0';
 }
 
-int SomLocation::glocCallback(int type, const char* buf, int len, char* locBuffer) {
-    switch (type) {
-        case TYPE_PLUS:
-            // fallthrough
-        case TYPE_ERROR:
-            strlcpy(locBuffer, buf, min((size_t)len, sizeof(SomLocation::_locBuffer)));
-            stripLfCr(locBuffer);
-            locationLog.trace("glocCallback: (%06x) %s", type, locBuffer);
-            break;
+void SomLocation::atCommandCallback(LocationModemResponse type, const char* buf, int len, void* param) {
+    auto context = static_cast<AtCommandContext*>(param);
+
+    // Match CME errors on every line, the AT parser may hand them over as information responses rather than errors
+    char line[32];
+    auto copy = min((size_t)len, sizeof(line) - 1);
+    memcpy(line, buf, copy);
+    line[copy] = '\0';
+    uint32_t code;
+    if (!LocationParser::parseCmeError(line, code)) {
+        context->self->_atStats.recordCme(context->command, code);
     }
 
-    return WAIT;
+    if (context->callback) {
+        context->callback(type, buf, len, context->self);
+    }
+}
+
+int SomLocation::atCommand(LocationAtCommand command, const char* line, LocationModemCallback callback,
+                           uint32_t timeoutMs) {
+    AtCommandContext context {this, command, callback};
+    auto sent = System.millis();
+    auto ret = _modem->command(atCommandCallback, &context, timeoutMs, line);
+    _atStats.record(command, (uint32_t)(System.millis() - sent), 0 == ret);
+    return ret;
 }
 
-int SomLocation::epeCallback(int type, const char* buf, int len, char* epeBuffer) {
+void SomLocation::getStatistics(LocationAtStatistics& stats) const {
+    _atStats.snapshot(stats);
+}
+
+void SomLocation::resetStatistics() {
+    _atStats.reset();
+}
+
+void SomLocation::pollCallback(LocationModemResponse type, const char* buf, int len, void* param) {
+    auto self = static_cast<SomLocation*>(param);
+    char* response = nullptr;
+
     switch (type) {
-        case TYPE_PLUS:
-            // fallthrough
-        case TYPE_ERROR:
-            strlcpy(epeBuffer, buf, min((size_t)len, sizeof(SomLocation::_epeBuffer)));
-            stripLfCr(epeBuffer);
+        case LocationModemResponse::Plus:
+            response = (strstr(buf, "+QGPSCFG:")) ? self->_epeBuffer : self->_locBuffer;
+            break;
+
+        case LocationModemResponse::Error:
+            // An error aborts the rest of the command line so it belongs to the first query without a response
+            response = ('\0' == self->_locBuffer[0]) ? self->_locBuffer : self->_epeBuffer;
+            break;
+
+        default:
             break;
     }
 
-    return WAIT;
+    if (response) {
+        // Both buffers are the same size
+        strlcpy(response, buf, min((size_t)len, sizeof(SomLocation::_locBuffer)));
+        stripLfCr(response);
+        locationLog.trace("pollCallback: (%d) %s", (int)type, response);
+    }
 }
 
 CME_Error SomLocation::parseCmeError(const char* buf) {
-    unsigned int error_code = 0;
-    auto nargs = sscanf(buf," +CME ERROR: %u", &error_code);
-
-    if (0 == nargs) {
+    uint32_t error_code = 0;
+    if (LocationParser::parseCmeError(buf, error_code)) {
         return CME_Error::NONE;
     }
 
@@ -297,16 +744,7 @@ CME_Error SomLocation::parseCmeError(const char* buf) {
 }
 
 int SomLocation::parseQloc(const char* buf, QlocContext& context, LocationPoint& point) {
-    // The general form of the AT command response is as follows
-    // <UTC HHMMSS.hh>,<latitude (-)dd.ddddd>,<longitude (-)ddd.ddddd>,<HDOP>,<altitude>,<fix>,<COG ddd.mm>,<spkm>,<spkn>,<date DDmmyy>,<nsat>
-    auto nargs = sscanf(buf, " +QGPSLOC: %02u%02u%02u.%*03u,%lf,%lf,%f,%f,%u,%03u.%02u,%f,%f,%02u%02u%02u,%u",
-                        &context.tm_hour, &context.tm_min, &context.tm_sec,
-                        &context.latitude, &context.longitude, &context.hdop, &context.altitude,
-                        &context.fix, &context.cogDegrees, &context.cogMinutes, &context.speedKmph, &context.speedKnots,
-                        &context.tm_day, &context.tm_month, &context.tm_year,
-                        &context.nsat);
-
-    if (0 == nargs) {
+    if (LocationParser::parseQloc(buf, context.fields)) {
         return -1;
     }
 
@@ -315,24 +753,33 @@ int SomLocation::parseQloc(const char* buf, QlocContext& context, LocationPoint&
     // QLOC=0 would give us ddmm.mmmmN/S, dddmm.mmmmE/W resulting in 8 significant digits for latitude and 9 in longitude
     // QLOC=1 would give us ddmm.mmmmmm,N/S, dddmm.mmmmmm,E/W resulting in 10 significant digits for latitude and 11 in longitude
     // QLOC=2 would give us (-)dd.ddddd, (-)ddd.ddddd resulting in 7 significant digits for latitude and 8 in longitude
+    auto& fields = context.fields;
 
-    // Convert tm structure to time_t (epoch time)
-    context.timeinfo.tm_year = context.tm_year + 2000 - 1900;  // GPRMC year from 2000 and then the difference from 1900
-    context.timeinfo.tm_mon = context.tm_month - 1;     // The number of months since January (0-11)
-    context.timeinfo.tm_mday = context.tm_day;
-    context.timeinfo.tm_hour = context.tm_hour;
-    context.timeinfo.tm_min = context.tm_min;
-    context.timeinfo.tm_sec = context.tm_sec;
-    point.epochTime = std::mktime(&context.timeinfo);
-
-    point.fix = context.fix;
-    point.latitude = context.latitude;
-    point.longitude = context.longitude;
-    point.altitude = context.altitude;
-    point.speed = context.speedKmph * 1000.0;
-    point.heading = (float)context.cogDegrees + (float)context.cogMinutes / 60.0;
-    point.horizontalDop = context.hdop;
-    point.satsInUse = context.nsat;
+    if ((fields.present & LOCATION_QLOC_DATE) && (fields.present & LOCATION_QLOC_UTC)) {
+        point.epochTime = LocationTime::epochFromUtc(fields.year + 2000, fields.month, fields.day,  // Year from 2000
+                                                     fields.hour, fields.minute, fields.second);
+    }
+
+    point.fix = fields.fix;
+    if (fields.present & LOCATION_QLOC_LATITUDE) {
+        point.latitude = LocationCoordinateTraits::fromE7(fields.latitude);
+    }
+    if (fields.present & LOCATION_QLOC_LONGITUDE) {
+        point.longitude = LocationCoordinateTraits::fromE7(fields.longitude);
+    }
+    if (fields.present & LOCATION_QLOC_ALTITUDE) {
+        point.altitude = (float)fields.altitude * 1.0e-3f;
+    }
+    if (fields.present & LOCATION_QLOC_SPEED_KMPH) {
+        point.speed = (float)fields.speedKmph / 360.0f;  // Hundredths of km/h to m/s
+    }
+    if (fields.present & LOCATION_QLOC_COG) {
+        point.heading = (float)fields.cogDegrees + (float)fields.cogMinutes / 60.0f;
+    }
+    if (fields.present & LOCATION_QLOC_HDOP) {
+        point.horizontalDop = (float)fields.hdop * 1.0e-2f;
+    }
+    point.satsInUse = fields.nsat;
 
     return 0;
 }
@@ -367,23 +814,713 @@ void SomLocation::parseEpeResponse(const char* buf, EpeContext& context, Locatio
         return;  // module just may have not been initialized
     }
 
-    auto nargs = sscanf(buf, " +QGPSCFG: \"estimation_error\",%f,%f,%f,%f",
-                        &context.h_acc, &context.v_acc, &context.speed_acc, &context.head_acc);
+    if (LocationParser::parseEpe(buf, context.fields)) {
+        return;
+    }
+
+    auto& fields = context.fields;
+    if (fields.present & LOCATION_EPE_HORIZONTAL) {
+        point.horizontalAccuracy = (float)fields.horizontal / 1000.0f;
+    }
+    if (fields.present & LOCATION_EPE_VERTICAL) {
+        point.verticalAccuracy = (float)fields.vertical / 1000.0f;
+    }
+}
+
+CME_Error SomLocation::poll(LocationPoint& point) {
+    _locBuffer[0] = '\0';
+    _epeBuffer[0] = '\0';
+
+    // Concatenate the position and estimated error queries so that each poll is a single AT transaction
+    auto sent = System.millis();
+    if (_ModemType::BG95_M5 == _modemType) {
+        atCommand(LocationAtCommand::Poll, R"(AT+QGPSLOC=2;+QGPSCFG="estimation_error")", pollCallback, 1000);
+    }
+    else {
+        atCommand(LocationAtCommand::Poll, R"(AT+QGPSLOC=2)", pollCallback, 1000);
+    }
+    recordPoll(sent);
+
+    auto ret = parseQlocResponse(_locBuffer, _qlocContext, point);
+    if (_ModemType::BG95_M5 == _modemType) {
+        parseEpeResponse(_epeBuffer, _epeContext, point);
+    }
+
+    return ret;
+}
+
+void SomLocation::nmeaUrcCallback(const char* prefix, const char* line, int len, void* param) {
+    auto self = static_cast<SomLocation*>(param);
+    self->_nmeaSeen.store(true);
+    int completed;
+    {
+        const std::lock_guard<Mutex> lock(self->_nmeaMutex);
+        completed = self->_nmea.feed(prefix, strlen(prefix));
+        completed |= self->_nmea.feed(line, len);
+    }
+
+    // Wake the acquisition loop once per position update, the queue coalesces updates it has not consumed yet
+    if (completed & (LOCATION_NMEA_GGA | LOCATION_NMEA_RMC)) {
+        uint8_t update = 1;
+        os_queue_put(self->_nmeaQueue, &update, 0, nullptr);
+    }
+}
+
+bool SomLocation::enableNmeaOutput() {
+    if (!_nmeaUrcRegistered) {
+        for (auto prefix : LOCATION_NMEA_URC_PREFIXES) {
+            if (_modem->addUrcHandler(prefix, nmeaUrcCallback, this)) {
+                locationLog.warn("NMEA output cannot be received, polling instead");
+                _nmeaUnavailable = true;
+                return false;
+            }
+        }
+        _nmeaUrcRegistered = true;
+    }
+
+    {
+        const std::lock_guard<Mutex> lock(_nmeaMutex);
+        _nmea.reset();
+    }
+    _nmeaEpoch = 0;
+    _nmeaSeen.store(false);
+    _nmeaEnabled = System.millis();
+
+    // GGA, RMC, GSV, GSA and VTG sentences delivered on the AT interface.  The BG95 sends "uartnmea" output to its
+    // debug UART rather than the AT port, in which case checkNmeaOutput() gives up on it for good.
+    atCommand(LocationAtCommand::Configure, R"(AT+QGPSCFG="nmeasrc",1)");
+    atCommand(LocationAtCommand::Configure, R"(AT+QGPSCFG="gpsnmeatype",31)");
+    atCommand(LocationAtCommand::Configure, R"(AT+QGPSCFG="outport","uartnmea")");
+    return true;
+}
+
+void SomLocation::checkNmeaOutput() {
+    if (!_push || _nmeaSeen.load() || ((System.millis() - _nmeaEnabled) < LOCATION_NMEA_FALLBACK_MS)) {
+        return;
+    }
+
+    // Later sessions with the same modem poll from the start rather than waiting for output again
+    locationLog.warn("No NMEA output from the modem, polling from now on");
+    disableNmeaOutput();
+    _push = false;
+    _nmeaUnavailable = true;
+}
+
+void SomLocation::disableNmeaOutput() {
+    atCommand(LocationAtCommand::Configure, R"(AT+QGPSCFG="outport","none")");
+    atCommand(LocationAtCommand::Configure, R"(AT+QGPSCFG="nmeasrc",0)");
+}
+
+CME_Error SomLocation::waitNmea(LocationPoint& point, system_tick_t timeout) {
+    uint8_t update = 0;
+    if (os_queue_take(_nmeaQueue, &update, timeout, nullptr)) {
+        return CME_Error::NONE;  // Nothing from the modem yet
+    }
+
+    LocationPoint nmea;
+    {
+        const std::lock_guard<Mutex> lock(_nmeaMutex);
+        nmea = _nmea.point();
+        _nmea.clearUpdated();
+    }
+
+    if (0 == nmea.fix) {
+        point.fix = 0;
+        return CME_Error::NO_FIX;
+    }
+    if (nmea.epochTime == _nmeaEpoch) {
+        return CME_Error::NONE;  // Another sentence of a position already counted
+    }
+    _nmeaEpoch = nmea.epochTime;
+
+    point.fix = nmea.fix;
+    point.epochTime = nmea.epochTime;
+    point.latitude = nmea.latitude;
+    point.longitude = nmea.longitude;
+    point.altitude = nmea.altitude;
+    point.speed = nmea.speed;
+    point.heading = nmea.heading;
+    point.horizontalDop = nmea.horizontalDop;
+    point.verticalDop = nmea.verticalDop;
+    point.satsInUse = nmea.satsInUse;
+
+    // Estimated error is not part of NMEA output so query it once per new position
+    _locBuffer[0] = '\0';
+    _epeBuffer[0] = '\0';
+    auto sent = System.millis();
+    atCommand(LocationAtCommand::EstimationError, R"(AT+QGPSCFG="estimation_error")", pollCallback, 1000);
+    recordPoll(sent);
+    parseEpeResponse(_epeBuffer, _epeContext, point);
+
+    return CME_Error::FIX;
+}
+
+bool SomLocation::isSettled(CME_Error ret, int fixCount, const LocationPoint& point) const {
+    return (CME_Error::FIX == ret) && (_settlingCount <= fixCount) &&
+           (point.horizontalDop <= _conf.hdopThreshold()) &&
+           (point.horizontalAccuracy <= _conf.haccThreshold());
+}
+
+bool SomLocation::waitCancel(system_tick_t timeout) {
+    uint8_t wake = 0;
+    os_queue_take(_cancelQueue, &wake, timeout, nullptr);
+    return _cancel.load();
+}
+
+void SomLocation::assistanceCallback(LocationModemResponse type, const char* buf, int len, void* param) {
+    auto self = static_cast<SomLocation*>(param);
+    if (LocationModemResponse::Plus == type) {
+        strlcpy(self->_locBuffer, buf, min((size_t)len, sizeof(SomLocation::_locBuffer)));
+        stripLfCr(self->_locBuffer);
+    }
+}
+
+void SomLocation::queryAssistance() {
+    _locBuffer[0] = '\0';
+    atCommand(LocationAtCommand::Assistance, R"(AT+QGPSXTRADATA?)", assistanceCallback);
+
+    uint32_t duration = 0;
+    time_t start = 0;
+    auto parsed = (0 == LocationParser::parseXtraData(_locBuffer, duration, start));
 
-    if (nargs) {
-        point.horizontalAccuracy = context.h_acc;
-        point.verticalAccuracy = context.v_acc;
+    const std::lock_guard<Mutex> lock(_assistanceMutex);
+    _assistance.start = (parsed && duration) ? start : 0;
+    _assistance.expires = (parsed && duration) ? start + (time_t)duration * 60 : 0;
+    _assistanceKnown = parsed;
+    if (parsed) {
+        locationLog.info("Assistance data valid for %lu minutes", (unsigned long)duration);
+    }
+}
+
+void SomLocation::injectAssistanceTime() {
+    // Time is only accepted once updateAssistance() has enabled XTRA
+    if (!_assistanceConfigured || (_ModemType::BG95_M5 != _modemType) || !Time.isValid()) {
+        return;
     }
 
-    return;
+    auto now = (time_t)Time.now();
+    struct tm utc = {};
+    gmtime_r(&now, &utc);
+    char command[80];
+    snprintf(command, sizeof(command), R"(AT+QGPSXTRATIME=0,"%04d/%02d/%02d,%02d:%02d:%02d",1,1,%u)",
+             utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec,
+             LOCATION_ASSISTANCE_TIME_UNCERTAINTY_MS);
+    if (0 == atCommand(LocationAtCommand::Assistance, command)) {
+        const std::lock_guard<Mutex> lock(_assistanceMutex);
+        _assistance.timeInjected = now;
+    }
+}
+
+void SomLocation::updateAssistance() {
+    // Leave the modem XTRA setting alone unless the configuration needs it
+    if ((_ModemType::BG95_M5 != _modemType) || !isXtraEnabled()) {
+        return;
+    }
+
+    if (!_assistanceConfigured) {
+        auto now = System.millis();
+        if (now < _assistanceRetry) {
+            return;
+        }
+        if (atCommand(LocationAtCommand::Assistance, "AT+QGPSXTRA=1")) {
+            // Back off so that a modem that refuses XTRA is not asked on every pass of the thread loop
+            _assistanceBackoff = (_assistanceBackoff) ? min(2 * _assistanceBackoff, LOCATION_ASSISTANCE_RETRY_MAXIMUM_MS)
+                                                      : LOCATION_ASSISTANCE_RETRY_MS;
+            _assistanceRetry = now + _assistanceBackoff;
+            locationLog.warn("Unable to enable XTRA, retrying in %lu seconds", (unsigned long)(_assistanceBackoff / 1000));
+            return;
+        }
+        _assistanceConfigured = true;
+        _assistanceBackoff = 0;
+        {
+            const std::lock_guard<Mutex> lock(_assistanceMutex);
+            _assistance = {};
+            _assistance.enabled = true;
+            _assistanceKnown = false;
+        }
+        if (_conf.assistance()) {
+            queryAssistance();
+        }
+    }
+
+    char filename[sizeof(_assistanceFile)];
+    {
+        const std::lock_guard<Mutex> lock(_assistanceMutex);
+        if (!_conf.assistance() || !_assistancePending) {
+            return;
+        }
+        strlcpy(filename, _assistanceFile, sizeof(filename));
+        _assistancePending = false;
+    }
+
+    // The modem needs the current time to make use of the data
+    injectAssistanceTime();
+    char command[sizeof(filename) + 24];
+    snprintf(command, sizeof(command), R"(AT+QGPSXTRADATA="%s")", filename);
+    if (atCommand(LocationAtCommand::Assistance, command)) {
+        locationLog.warn("Unable to load assistance data from %s", filename);
+    }
+    queryAssistance();
+}
+
+LocationStartType SomLocation::classifyStart() {
+    // Seconds since the last settled position, from this boot or from the persisted reference
+    int64_t sinceFix = -1;
+    {
+        const std::lock_guard<Mutex> lock(_lastFixMutex);
+        if (_lastFixValid) {
+            sinceFix = (int64_t)((System.millis() - _lastFixMillis) / 1000);
+        }
+        else if (_referenceValid && Time.isValid() && (Time.now() >= _referenceFix.epochTime)) {
+            sinceFix = (int64_t)(Time.now() - _referenceFix.epochTime);
+        }
+    }
+
+    bool assisted;
+    {
+        const std::lock_guard<Mutex> lock(_assistanceMutex);
+        assisted = _assistanceKnown && Time.isValid() && (Time.now() < _assistance.expires);
+    }
+
+    if ((0 <= sinceFix) && (LOCATION_HOT_START_SECONDS > sinceFix)) {
+        return LocationStartType::Hot;
+    }
+    if (assisted || ((0 <= sinceFix) && (LOCATION_WARM_START_SECONDS > sinceFix))) {
+        return LocationStartType::Warm;
+    }
+    return LocationStartType::Cold;
+}
+
+void SomLocation::applyStartPolicy(LocationStartType type) {
+    auto policy = _conf.startPolicy(type);
+    _startType = type;
+    _settlingCount = (policy.settlingCount) ? (int)policy.settlingCount : LOCATION_REQUIRED_SETTLING_COUNT;
+    _sessionPollInterval = (policy.pollIntervalMs) ? policy.pollIntervalMs : _conf.pollIntervalMinimum();
+    _sessionFixSeconds = (policy.maximumFixSeconds) ? min(policy.maximumFixSeconds, _conf.maximumFixTime())
+                                                    : _conf.maximumFixTime();
+}
+
+void SomLocation::setRfOwner(LocationRfOwner owner) {
+    if ((owner == _rfOwner) || (_ModemType::BG95_M5 != _modemType)) {
+        return;
+    }
+    auto gnss = (LocationRfOwner::Gnss == owner);
+    if (0 == atCommand(LocationAtCommand::Configure,
+                       (gnss) ? R"(AT+QGPSCFG="priority",0)" : R"(AT+QGPSCFG="priority",1)")) {
+        _rfOwner = owner;
+        locationLog.trace("RF priority to %s", (gnss) ? "GNSS" : "cellular");
+    }
+}
+
+void SomLocation::scheduleRf(bool settled) {
+    setRfOwner(_rfScheduler.next(System.millis(), isCellularBusy(), settled));
+}
+
+void SomLocation::startSession() {
+    // Discard a wake up left over from a cancellation already handled
+    uint8_t wake = 0;
+    os_queue_take(_cancelQueue, &wake, 0, nullptr);
+
+    _sessionTiming = {};
+    _sessionStart = System.millis();
+    setAntennaPower();
+    auto powered = System.millis();
+    _sessionTiming.antennaSettleMs = (uint32_t)(powered - _sessionStart);
+
+    // Assistance data and time must be in place before the receiver starts
+    updateAssistance();
+    injectAssistanceTime();
+    applyStartPolicy(classifyStart());
+
+    locationLog.trace("Started %s start aquisition", LOCATION_START_NAMES[(size_t)_startType]);
+    atCommand(LocationAtCommand::Start, R"(AT+QGPS=1)");
+    _sessionTiming.startCommandMs = (uint32_t)(System.millis() - powered);
+    if (_ModemType::BG95_M5 == _modemType) {
+        atCommand(LocationAtCommand::Configure, R"(AT+QGPSCFG="nmea_epe",1)");
+        setConstellationBg95(_conf.constellations());
+    }
+    _push = (LocationAcquisitionMode::Push == _conf.acquisitionMode()) && (_ModemType::BG95_M5 == _modemType) &&
+            !_nmeaUnavailable && enableNmeaOutput();
+    _rfScheduler.begin(_conf.rfSharingWindow(), _conf.rfSharingGap(), _conf.rfSharingDefer());
+    scheduleRf(false);
+}
+
+void SomLocation::endSession() {
+    if (_push) {
+        disableNmeaOutput();
+        _push = false;
+    }
+    _rfScheduler.release(System.millis());
+    setRfOwner(LocationRfOwner::Cellular);
+    auto sent = System.millis();
+    atCommand(LocationAtCommand::End, R"(AT+QGPSEND)");
+    _sessionTiming.endCommandMs = (uint32_t)(System.millis() - sent);
+    clearAntennaPower();
+    saveTiming();
+    saveReference();
+}
+
+LocationResults SomLocation::acquire(LocationPoint& point) {
+    if (_cancel.exchange(false)) {
+        return LocationResults::Cancelled;
+    }
+
+    startSession();
+
+    auto maxTime = (uint64_t)_sessionFixSeconds * 1000;
+    uint64_t firstFix = {};
+    int fixCount = {};
+    LocationResults response {LocationResults::TimedOut};
+    bool power = false;
+    point.startType = _startType;
+    _pollScheduler.begin(_sessionPollInterval, max(_sessionPollInterval, _conf.pollIntervalMaximum()), _conf.pollBackoff());
+    auto start = System.millis();
+    while ((power = isModemOn())) {
+        auto now = System.millis();
+        if ((now - start) >= maxTime)
+            break;
+        if (_cancel.exchange(false)) {
+            locationLog.info("Acquisition cancelled");
+            response = LocationResults::Cancelled;
+            break;
+        }
+        scheduleRf(false);
+        checkNmeaOutput();
+        auto ret = (_push) ? waitNmea(point, min((system_tick_t)(maxTime - (now - start)), LOCATION_NMEA_WAIT_MS))
+                           : poll(point);
+        if (CME_Error::FIX == ret) {
+            fixCount++;
+            if (0 == firstFix) {
+                firstFix = System.millis();
+                point.systemTime = Time.now();
+            }
+            _fixRing.push(point);
+        }
+        if (isSettled(ret, fixCount, point)) {
+            _sessionTiming.settleMs = (uint32_t)(System.millis() - firstFix);
+            response = LocationResults::Fixed;
+            break;
+        }
+        if (!_push) {
+            auto interval = _pollScheduler.next(CME_Error::FIX == ret);
+            auto elapsed = System.millis() - start;
+            waitCancel((elapsed < maxTime) ? (system_tick_t)min((uint64_t)interval, maxTime - elapsed) : 0);
+        }
+    }
+
+    if (firstFix) {
+        _sessionTiming.firstFixMs = (uint32_t)(firstFix - start);
+    }
+    endSession();
+
+    if (!power && (LocationResults::Fixed != response)) {
+        response = LocationResults::Unavailable;
+    }
+
+    if (firstFix)
+        point.timeToFirstFix = (float)(firstFix - start) / 1000.0;
+
+    if (LocationResults::Fixed == response) {
+        saveLastFix(point);
+    }
+
+    return response;
+}
+
+void SomLocation::startTrackingSession(unsigned int intervalMs, bool publish) {
+    if (!_tracking.load()) {
+        startSession();
+    }
+    _trackInterval = intervalMs;
+    _trackPublish = publish;
+    _trackStart = System.millis();
+    _trackNextPoll = _trackStart;
+    _trackFirstFix = 0;
+    _trackFixCount = 0;
+    _trackWork = {};
+    _trackWork.startType = _startType;
+    {
+        const std::lock_guard<Mutex> lock(_trackMutex);
+        _trackSettled = false;
+    }
+    _tracking.store(true);
+    locationLog.info("Tracking every %u ms", intervalMs);
+}
+
+void SomLocation::stopTrackingSession(LocationResults response) {
+    if (!_tracking.load()) {
+        return;
+    }
+    _tracking.store(false);
+    {
+        const std::lock_guard<Mutex> lock(_trackMutex);
+        _trackSettled = false;
+    }
+    endSession();
+    if (_acquiring.load()) {
+        completeWaiters(response, _trackWork);
+    }
+    locationLog.info("Tracking stopped");
+}
+
+void SomLocation::trackingPoll() {
+    auto now = System.millis();
+    _trackNextPoll = now + _trackInterval;
+
+    if (!isModemOn()) {
+        stopTrackingSession(LocationResults::Unavailable);
+        return;
+    }
+
+    checkNmeaOutput();
+    auto ret = (_push) ? waitNmea(_trackWork, 0) : poll(_trackWork);
+    if (CME_Error::FIX == ret) {
+        _trackFixCount++;
+        if (0 == _trackFirstFix) {
+            _trackFirstFix = System.millis();
+            _trackWork.systemTime = Time.now();
+            _trackWork.timeToFirstFix = (float)(_trackFirstFix - _trackStart) / 1000.0;
+            _sessionTiming.firstFixMs = (uint32_t)(_trackFirstFix - _trackStart);
+        }
+        _fixRing.push(_trackWork);
+    }
+    else if (CME_Error::NO_FIX == ret) {
+        _trackFixCount = 0;
+        const std::lock_guard<Mutex> lock(_trackMutex);
+        _trackSettled = false;
+    }
+
+    // Give the RF path back to cellular before publishing a settled fix
+    auto settled = isSettled(ret, _trackFixCount, _trackWork);
+    scheduleRf(settled);
+    if (settled) {
+        if (0 == _sessionTiming.settleMs) {
+            _sessionTiming.settleMs = (uint32_t)(System.millis() - _trackFirstFix);
+        }
+        _trackWork.systemTime = Time.now();
+        {
+            const std::lock_guard<Mutex> lock(_trackMutex);
+            _trackPoint = _trackWork;
+            _trackSettled = true;
+        }
+        saveLastFix(_trackWork);
+        if (_conf.reference() && ((now - _referenceSaved) >= LOCATION_REFERENCE_SAVE_MS)) {
+            saveReference();  // Tracking sessions can run for days before endSession()
+        }
+        auto published = _acquiring.load() && completeWaiters(LocationResults::Fixed, _trackWork);
+        if (_trackPublish && !published) {
+            publishLocation(_trackWork);
+        }
+    }
+    else if (_acquiring.load() && ((now - _trackRequestStart) >= (uint64_t)_conf.maximumFixTime() * 1000)) {
+        completeWaiters(LocationResults::TimedOut, _trackWork);
+    }
+
+    saveTiming();
+}
+
+void SomLocation::startDutyCycleSession(bool publish) {
+    _dutyScheduler.begin(_conf.dutyCycleMinimum() * 1000, _conf.dutyCycleMaximum() * 1000, _conf.dutyCycleDistance());
+    _dutyPublish = publish;
+    _dutyNext = System.millis();
+    _dutyCycling.store(true);
+    locationLog.info("Duty cycle between %u and %u s", _conf.dutyCycleMinimum(), _conf.dutyCycleMaximum());
+}
+
+void SomLocation::dutyCycleAcquire() {
+    {
+        // Requests that arrive during the acquisition join it rather than starting another
+        const std::lock_guard<Mutex> lock(_waiterMutex);
+        if (_acquiring.load()) {
+            return;  // A requested acquisition is queued and reschedules the duty cycle once done
+        }
+        _acquiring.store(true);
+    }
+
+    _acquirePoint = {};
+    auto response = (isModemOn()) ? acquire(_acquirePoint) : LocationResults::Unavailable;
+    auto published = completeWaiters(response, _acquirePoint);
+    if (_dutyPublish && !published && (LocationResults::Fixed == response)) {
+        publishLocation(_acquirePoint);
+    }
+    scheduleDutyCycle(response, _acquirePoint);
+}
+
+void SomLocation::scheduleDutyCycle(LocationResults response, const LocationPoint& point) {
+    auto interval = _dutyScheduler.next(LocationResults::Fixed == response,
+                                        LocationCoordinateTraits::toE7(point.latitude),
+                                        LocationCoordinateTraits::toE7(point.longitude),
+                                        point.speed, point.heading, point.horizontalAccuracy);
+    _dutyNext = System.millis() + interval;
+    locationLog.info("Next acquisition in %u ms, stationary for %u fixes", interval, _dutyScheduler.stationary());
+}
+
+bool SomLocation::readTrackedPoint(LocationPoint& point) {
+    const std::lock_guard<Mutex> lock(_trackMutex);
+    if (!_tracking.load() || !_trackSettled) {
+        return false;
+    }
+    point = _trackPoint;
+    return true;
+}
+
+void SomLocation::publishLocation(const LocationPoint& point) {
+    if (!isConnected() && _store.isOpen()) {
+        storeLocation(point);
+        return;
+    }
+
+    if (1 < _conf.publishBatchCount()) {
+        batchLocation(point);
+        return;
+    }
+
+    if (!isConnected()) {
+        return;
+    }
+
+    const std::lock_guard<Mutex> lock(_publishMutex);
+    locationLog.info("Publishing loc event");
+    auto packed = (LocationPublishEncoding::Packed == _conf.publishEncoding());
+    if (packed) {
+        buildPublishPacked(_publishBuffer, sizeof(_publishBuffer), point, _reqid);
+    }
+    else {
+        buildPublish(_publishBuffer, sizeof(_publishBuffer), point, _reqid);
+    }
+    auto published = Particle.publish((packed) ? "locb" : "loc", _publishBuffer);
+    if (published) {
+        _reqid++;
+    }
+}
+
+void SomLocation::batchLocation(const LocationPoint& point) {
+    if (0 == point.fix) {
+        return;  // Batches only carry positions
+    }
+
+    // The request number is only read and advanced under the publish lock
+    const std::lock_guard<Mutex> lock(_publishMutex);
+    LocationPackedFix fix;
+    packFix(point, _reqid, fix);
+    if (!_batch.add(fix)) {
+        // Event is full, publish what is there and start a new batch with this fix
+        if (!flushBatch()) {
+            spillBatch();
+        }
+        _batch.add(fix);
+    }
+    if (1 == _batch.count()) {
+        _batchStart = System.millis();
+    }
+    if (_batch.count() >= _conf.publishBatchCount()) {
+        flushBatch();
+    }
+}
+
+bool SomLocation::flushBatch() {
+    if ((0 == _batch.count()) || !isConnected()) {
+        return false;
+    }
+
+    locationLog.info("Publishing locs event with %u fixes", (unsigned int)_batch.count());
+    LocationEncoder::base64Encode(_batch.data(), _batch.size(), _publishBuffer, sizeof(_publishBuffer));
+    if (!Particle.publish("locs", _publishBuffer)) {
+        return false;
+    }
+    _reqid++;
+    _batch.clear();
+    return true;
+}
+
+void SomLocation::spillBatch() {
+    // Move the fixes to the offline store, when there is one, so that they are replayed once connected
+    auto stored = 0;
+    if (_store.isOpen()) {
+        stored = LocationBatchEncoder::decode(_batch.data(), _batch.size(), [](const LocationPackedFix& fix, void* param) {
+            auto self = static_cast<SomLocation*>(param);
+            auto copy = fix;
+            copy.reqId = self->_reqid;
+            if (self->_store.append(copy)) {
+                locationLog.warn("Unable to store fix");
+            }
+        }, this);
+    }
+    if (0 < stored) {
+        locationLog.info("Stored %d batched fixes", stored);
+    }
+    else {
+        locationLog.warn("Dropping %u batched fixes", (unsigned int)_batch.count());
+    }
+    _batch.clear();
+}
+
+void SomLocation::checkBatchAge() {
+    auto maxAge = (uint64_t)_conf.publishBatchAge() * 1000;
+    if ((0 == maxAge) || (LocationRfOwner::Gnss == _rfOwner)) {
+        return;  // Wait for the GNSS window to end rather than stall the publish
+    }
+
+    const std::lock_guard<Mutex> lock(_publishMutex);
+    if (_batch.count() && ((System.millis() - _batchStart) >= maxAge)) {
+        flushBatch();
+    }
+}
+
+void SomLocation::storeLocation(const LocationPoint& point) {
+    if (0 == point.fix) {
+        return;  // Only positions are worth keeping
+    }
+
+    LocationPackedFix fix;
+    const std::lock_guard<Mutex> lock(_publishMutex);
+    packFix(point, _reqid, fix);
+    if (_store.append(fix)) {
+        locationLog.warn("Unable to store fix");
+    }
+}
+
+void SomLocation::replayStored() {
+    if (!_store.isOpen() || !isConnected() || (LocationRfOwner::Gnss == _rfOwner)) {
+        return;
+    }
+
+    const std::lock_guard<Mutex> lock(_publishMutex);
+    auto now = System.millis();
+    if (!_store.pending() || (now < _nextReplay)) {
+        return;
+    }
+    _nextReplay = now + _conf.storeOfflineReplayInterval();
+
+    LocationPackedFix fix;
+    if (_store.peek(fix)) {
+        return;
+    }
+    uint8_t record[LocationEncoder::PackedSize];
+    auto size = LocationEncoder::pack(fix, record, sizeof(record));
+    LocationEncoder::base64Encode(record, size, _publishBuffer, sizeof(_publishBuffer));
+    if (!Particle.publish("locb", _publishBuffer)) {
+        return;
+    }
+
+    // Writing the replay position less often saves flash wear at the cost of repeats after a reset
+    _store.pop();
+    if (!_store.pending() || (0 == (++_replayed % LOCATION_STORE_COMMIT_INTERVAL))) {
+        _store.commit();
+    }
 }
 
 void SomLocation::threadLoop()
 {
     auto loop = true;
     while (loop) {
-        // Look for requests and provide a loop delay
-        auto event = waitOnCommandEvent(LOCATION_PERIOD_SUCCESS_MS);
+        // Look for requests and provide a loop delay, or wait until the next tracking poll
+        system_tick_t timeout = LOCATION_PERIOD_SUCCESS_MS;
+        if (_tracking.load()) {
+            auto now = System.millis();
+            timeout = (_trackNextPoll > now) ? (system_tick_t)min((uint64_t)timeout, _trackNextPoll - now) : 0;
+        }
+        auto event = waitOnCommandEvent(timeout);
 
         switch (event.command) {
             case LocationCommand::None:
@@ -391,81 +1528,45 @@ void SomLocation::threadLoop()
                 break;
 
             case LocationCommand::Acquire: {
-                _acquiring.store(true);
-                SCOPE_GUARD({
-                    _acquiring.store(false);
-                    clearAntennaPower();
-                });
-
-                setAntennaPower();
-
-                locationLog.trace("Started aquisition");
-                Cellular.command(R"(AT+QGPS=1)");
-                if (_ModemType::BG95_M5 == _modemType) {
-                    Cellular.command(R"(AT+QGPSCFG="nmea_epe",1)");
-                    setConstellationBg95(_conf.constellations());
+                if (!_acquiring.load()) {
+                    // Waiters were already completed by a cancellation
+                    break;
                 }
-                auto maxTime = (uint64_t)_conf.maximumFixTime() * 1000;
-                uint64_t firstFix = {};
-                int fixCount = {};
-                LocationResults response {LocationResults::TimedOut};
-                bool power = false;
-                auto start = System.millis();
-                while ((power = isModemOn())) {
-                    auto now = System.millis();
-                    if ((now - start) >= maxTime)
-                        break;
-                    Cellular.command(glocCallback, _locBuffer, 1000, R"(AT+QGPSLOC=2)");
-                    auto ret = parseQlocResponse(_locBuffer, _qlocContext, *event.point);
-                    if (CME_Error::FIX == ret) {
-                        fixCount++;
-                        if (0 == firstFix) {
-                            firstFix = System.millis();
-                            event.point->systemTime = Time.now();
-                        }
-                    }
-                    if (_ModemType::BG95_M5 == _modemType) {
-                        Cellular.command(epeCallback, _epeBuffer, 1000, R"(AT+QGPSCFG="estimation_error")");
-                        parseEpeResponse(_epeBuffer, _epeContext, *event.point);
-                    }
-                    if ((CME_Error::FIX == ret) && (LOCATION_REQUIRED_SETTLING_COUNT == fixCount) &&
-                        (event.point->horizontalDop <= _conf.hdopThreshold()) &&
-                        (event.point->horizontalAccuracy <= _conf.haccThreshold())) {
-
-                        response = LocationResults::Fixed;
-                        break;
-                    }
-                    delay(LOCATION_PERIOD_ACQUIRE_MS);
+                if (_tracking.load()) {
+                    // Serve the waiters from the next settled fix of the running session
+                    _trackRequestStart = System.millis();
+                    break;
                 }
 
-                Cellular.command(R"(AT+QGPSEND)");
-
-                if (!power && (LocationResults::Fixed != response)) {
-                    response = LocationResults::Unavailable;
+                _acquirePoint = {};
+                auto response = acquire(_acquirePoint);
+                completeWaiters(response, _acquirePoint);
+                if (_dutyCycling.load()) {
+                    scheduleDutyCycle(response, _acquirePoint);
                 }
+                break;
+            }
 
-                if (firstFix)
-                    event.point->timeToFirstFix = (float)(firstFix - start) / 1000.0;
+            case LocationCommand::StartTracking:
+                startTrackingSession(event.interval, event.publish);
+                break;
 
-                if (event.sendResponse) {
-                    locationLog.trace("Sending synchronous completion");
-                    os_queue_put(_responseQueue, &response, 0, nullptr);
-                }
-                else if (event.doneCallback) {
-                    if (event.publish && (LocationResults::Fixed == response) && isConnected()) {
-                        locationLog.info("Publishing loc event");
-                        buildPublish(_publishBuffer, sizeof(_publishBuffer), *event.point, _reqid);
-                        auto published = Particle.publish("loc", _publishBuffer);
-                        if (published) {
-                            _reqid++;
-                        }
-                    }
-                    locationLog.trace("Sending asynchronous completion");
-                    event.doneCallback(response);
-                }
+            case LocationCommand::StopTracking:
+                stopTrackingSession(LocationResults::TimedOut);
+                break;
 
+            case LocationCommand::StartDutyCycle:
+                startDutyCycleSession(event.publish);
+                break;
+
+            case LocationCommand::StopDutyCycle:
+                _dutyCycling.store(false);
+                locationLog.info("Duty cycle stopped");
+                break;
+
+            case LocationCommand::InjectAssistance:
+                // Loaded below once no tracking session is running
                 break;
-            }
 
             case LocationCommand::Exit:
                 // Get out of main loop and join
@@ -475,15 +1576,41 @@ void SomLocation::threadLoop()
             default:
                 break;
         }
+
+        if (_cancel.exchange(false)) {
+            // Nothing was acquiring, so stop the tracking session or release requests not yet started
+            if (_tracking.load()) {
+                stopTrackingSession(LocationResults::Cancelled);
+            }
+            else if (_acquiring.load()) {
+                _acquirePoint = {};
+                completeWaiters(LocationResults::Cancelled, _acquirePoint);
+            }
+        }
+
+        if (_tracking.load() && (System.millis() >= _trackNextPoll)) {
+            trackingPoll();
+        }
+        else if (!_tracking.load() && isModemOn() && detectModemType()) {
+            updateAssistance();
+            if (_dutyCycling.load() && (System.millis() >= _dutyNext)) {
+                dutyCycleAcquire();
+            }
+        }
+
+        checkBatchAge();
+        replayStored();
     }
 
+    stopTrackingSession(LocationResults::Unavailable);
+
     // Kill the thread if we get here
     _thread->cancel();
 }
 
-size_t SomLocation::buildPublish(char* buffer, size_t len, LocationPoint& point, unsigned int seq) {
+size_t SomLocation::buildPublish(char* buffer, size_t len, const LocationPoint& point, unsigned int seq) {
     memset(buffer, 0, len);
-    JSONBufferWriter writer(buffer, len);
+    LocationJsonWriter writer(buffer, len);
     writer.beginObject();
         writer.name("cmd").value("loc");
         if (point.systemTime) {
@@ -497,8 +1624,15 @@ size_t SomLocation::buildPublish(char* buffer, size_t len, LocationPoint& point,
         else {
             writer.name("lck").value(1);
             writer.name("time").value((unsigned int)point.epochTime);
+#if LOCATION_FIXED_POINT_COORDINATES
+            writer.name("lat");
+            writer.coordinateValue(point.latitude);
+            writer.name("lon");
+            writer.coordinateValue(point.longitude);
+#else
             writer.name("lat").value(point.latitude, 8);
             writer.name("lon").value(point.longitude, 8);
+#endif // LOCATION_FIXED_POINT_COORDINATES
             writer.name("alt").value(point.altitude, 3);
             writer.name("hd").value(point.heading, 2);
             writer.name("spd").value(point.speed, 2);
@@ -511,6 +1645,9 @@ size_t SomLocation::buildPublish(char* buffer, size_t len, LocationPoint& point,
             }
             writer.name("nsat").value(point.satsInUse);
             writer.name("ttff").value(point.timeToFirstFix, 1);
+            if ((LocationStartType::Unknown != point.startType) && (LocationStartType::Count > point.startType)) {
+                writer.name("start").value(LOCATION_START_NAMES[(size_t)point.startType]);
+            }
         }
         writer.endObject();
         writer.name("req_id").value(seq);
@@ -518,3 +1655,55 @@ size_t SomLocation::buildPublish(char* buffer, size_t len, LocationPoint& point,
 
     return writer.dataSize();
 }
+
+void SomLocation::packFix(const LocationPoint& point, unsigned int seq, LocationPackedFix& fix) {
+    fix = {};
+    fix.reqId = seq;
+    fix.systemTime = (uint32_t)point.systemTime;
+    if (0 != point.fix) {
+        fix.locked = true;
+        fix.epochTime = (uint32_t)point.epochTime;
+        fix.latitude = LocationCoordinateTraits::toE7(point.latitude);
+        fix.longitude = LocationCoordinateTraits::toE7(point.longitude);
+        auto altitude = point.altitude * 1000.0f;
+        fix.altitude = (int32_t)((0.0f > altitude) ? altitude - 0.5f : altitude + 0.5f);
+        fix.heading = packUnsigned16(point.heading, 100.0f);
+        fix.speed = packUnsigned16(point.speed, 100.0f);
+        fix.horizontalDop = packUnsigned16(point.horizontalDop, 10.0f);
+        fix.horizontalAccuracy = packUnsigned16(point.horizontalAccuracy, 100.0f);
+        fix.verticalAccuracy = packUnsigned16(point.verticalAccuracy, 100.0f);
+        fix.satsInUse = (uint8_t)min(point.satsInUse, 255u);
+        fix.timeToFirstFix = packUnsigned16(point.timeToFirstFix, 10.0f);
+        fix.startType = (uint8_t)point.startType;
+    }
+}
+
+void SomLocation::unpackFix(const LocationPackedFix& fix, LocationPoint& point) {
+    point = {};
+    point.systemTime = (time_t)fix.systemTime;
+    if (!fix.locked) {
+        return;
+    }
+    point.fix = 1;
+    point.epochTime = (time_t)fix.epochTime;
+    point.latitude = LocationCoordinateTraits::fromE7(fix.latitude);
+    point.longitude = LocationCoordinateTraits::fromE7(fix.longitude);
+    point.altitude = (float)fix.altitude / 1000.0f;
+    point.heading = (float)fix.heading / 100.0f;
+    point.speed = (float)fix.speed / 100.0f;
+    point.horizontalDop = (float)fix.horizontalDop / 10.0f;
+    point.horizontalAccuracy = (float)fix.horizontalAccuracy / 100.0f;
+    point.verticalAccuracy = (float)fix.verticalAccuracy / 100.0f;
+    point.satsInUse = fix.satsInUse;
+    point.timeToFirstFix = (float)fix.timeToFirstFix / 10.0f;
+    point.startType = (LocationStartType)fix.startType;
+}
+
+size_t SomLocation::buildPublishPacked(char* buffer, size_t len, const LocationPoint& point, unsigned int seq) {
+    LocationPackedFix fix;
+    packFix(point, seq, fix);
+
+    uint8_t record[LocationEncoder::PackedSize];
+    auto size = LocationEncoder::pack(fix, record, sizeof(record));
+    return LocationEncoder::base64Encode(record, size, buffer, len);
+}
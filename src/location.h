@@ -16,12 +16,39 @@
 
 #pragma once
 
+#include <chrono>
+
+#include "location_nmea.h"
 #include "location_options.h"
+#include "location_encode.h"
+#include "location_modem.h"
+#include "location_modem_cellular.h"
+#include "location_parser.h"
 #include "location_point.h"
+#include "location_ring.h"
+#include "location_scheduler.h"
+#include "location_stats.h"
+#include "location_store.h"
+#include "location_time.h"
+
+#ifndef LOCATION_FIX_RING_SIZE
+#define LOCATION_FIX_RING_SIZE (8)  /**< Number of fixes held for subscribers, must be a power of two */
+#endif // LOCATION_FIX_RING_SIZE
+
+/**
+ * @brief Read position of a fix subscriber
+ *
+ */
+using LocationSubscriber = LocationRingCursor;
 
 enum class LocationCommand {
     None,                   /**< Do nothing */
     Acquire,                /**< Perform GNSS acquisition */
+    StartTracking,          /**< Open a GNSS session and keep it running */
+    StopTracking,           /**< Close a running GNSS session */
+    InjectAssistance,       /**< Load XTRA assistance data once no session is running */
+    StartDutyCycle,         /**< Acquire at intervals chosen from motion */
+    StopDutyCycle,          /**< Stop acquiring at intervals */
     Exit,                   /**< Exit from thread */
 };
 
@@ -34,9 +61,40 @@ enum class LocationResults {
     Unsupported,            /**< GNSS is not supported on this hardware */
     Idle,                   /**< No GNSS acquistions are pending or in progress */
     Acquiring,              /**< GNSS is aquiring a fix */
-    Pending,                /**< A previous GNSS acquisition is in progress */
+    Pending,                /**< Too many requests are already waiting on the GNSS acquisition in progress */
     Fixed,                  /**< GNSS position has been aquired and fixed */
     TimedOut,               /**< GNSS has not fix */
+    Cancelled,              /**< GNSS acquisition was cancelled */
+};
+
+/**
+ * @brief Duration of each phase of a GNSS session, in milliseconds
+ *
+ */
+struct LocationTiming {
+    uint32_t antennaSettleMs;       /**< Antenna power settling delay */
+    uint32_t startCommandMs;        /**< AT+QGPS=1 round trip */
+    unsigned int polls;             /**< Number of position queries */
+    uint32_t pollLastMs;            /**< Round trip of the most recent position query */
+    uint32_t pollMinimumMs;         /**< Shortest position query round trip */
+    uint32_t pollMaximumMs;         /**< Longest position query round trip */
+    uint32_t pollTotalMs;           /**< Sum of position query round trips */
+    uint32_t firstFixMs;            /**< Start of polling to the first fix, 0 without a fix */
+    uint32_t settleMs;              /**< First fix to the settled position, 0 if not settled */
+    uint32_t endCommandMs;          /**< AT+QGPSEND round trip, 0 while the session is running */
+    uint32_t sessionMs;             /**< Session start to end, or to the latest poll while running */
+    uint32_t gnssPriorityMs;        /**< Time GNSS had RF priority, see LocationConfiguration::rfSharing() */
+};
+
+/**
+ * @brief State of XTRA assistance in the modem
+ *
+ */
+struct LocationAssistance {
+    bool enabled;                   /**< XTRA is enabled in the modem */
+    time_t start;                   /**< Start of the validity of the loaded data, 0 if none is loaded */
+    time_t expires;                 /**< End of the validity of the loaded data, 0 if none is loaded */
+    time_t timeInjected;            /**< System time last injected into the modem, 0 if never */
 };
 
 /**
@@ -47,10 +105,20 @@ using LocationDone = std::function<void(LocationResults)>;
 
 struct LocationCommandContext {
     LocationCommand command {LocationCommand::None};
-    bool sendResponse {false};
-    LocationDone doneCallback {};
-    bool publish {false};
-    LocationPoint* point {nullptr};
+    unsigned int interval {};
+    bool publish {};
+};
+
+/**
+ * @brief Caller waiting on the result of an acquisition
+ *
+ */
+struct LocationWaiter {
+    LocationPoint* point {nullptr};             /**< Receives a copy of the acquired point, null if unused */
+    LocationDone callback {};                   /**< Asynchronous completion callback */
+    bool publish {false};                       /**< Publish the point once acquired */
+    LocationResults* result {nullptr};          /**< Synchronous result */
+    os_semaphore_t done {nullptr};              /**< Synchronous completion signal */
 };
 
 enum class CME_Error {
@@ -70,6 +138,8 @@ enum class CME_Error {
  *
  */
 class SomLocation {
+    friend class LocationBenchmark;  // Measures private parsing and publishing functions in examples/benchmark
+
 public:
     /**
      * @brief Singleton class instance for SomLocation
@@ -93,6 +163,26 @@ public:
      */
     int begin(LocationConfiguration& configuration);
 
+    /**
+     * @brief Configure the SomLocation class to use the given modem instead of the cellular modem
+     *
+     * Must only be called while no acquisition or tracking session is in progress.
+     *
+     * @param configuration Structure containing configuration
+     * @param modem Modem used for all GNSS commands, which must remain valid while in use
+     * @retval 0 Success
+     */
+    int begin(LocationConfiguration& configuration, LocationModem& modem);
+
+    /**
+     * @brief Get the cellular modem, used unless begin() is given another modem
+     *
+     * @return LocationModem& Cellular modem, to switch back to with begin()
+     */
+    LocationModem& cellularModem() {
+        return _cellularModem;
+    }
+
     /**
      * @brief Get GNSS position, synchronously
      *
@@ -112,6 +202,98 @@ public:
      */
     LocationResults getLocation(LocationPoint& point, LocationDone callback, bool publish = false);
 
+    /**
+     * @brief Get GNSS position, synchronously, accepting a previously settled position no older than the given age
+     *
+     * @param point Location point with position
+     * @param maximumAge Oldest cached position that satisfies the request
+     * @param publish Publish location point after aquisition
+     * @return LocationResults
+     */
+    LocationResults getLocation(LocationPoint& point, std::chrono::milliseconds maximumAge, bool publish = false);
+
+    /**
+     * @brief Get GNSS position, asynchronously, accepting a previously settled position no older than the given age
+     *
+     * When a cached position is fresh enough the callback is invoked before this function returns.
+     *
+     * @param point Location point with position
+     * @param maximumAge Oldest cached position that satisfies the request
+     * @param callback Callback function to call after aquisition completion
+     * @param publish Publish location point after aquisition
+     * @return LocationResults
+     */
+    LocationResults getLocation(LocationPoint& point, std::chrono::milliseconds maximumAge, LocationDone callback, bool publish = false);
+
+    /**
+     * @brief Get the last settled GNSS position
+     *
+     * @param point Location point with the last settled position
+     * @param age Optional time, in milliseconds, since the position settled
+     * @return true A settled position is available
+     * @return false No position has settled since startup
+     */
+    bool getLastLocation(LocationPoint& point, system_tick_t* age = nullptr);
+
+    /**
+     * @brief Get the last settled GNSS position kept across resets
+     *
+     * Only available when LocationConfiguration::reference() is enabled.  Unlike getLastLocation() this includes the
+     * position saved before the last reset.
+     *
+     * @param point Location point with the reference position, its epochTime gives its age
+     * @return true A reference position is available
+     * @return false No position has settled since the reference was enabled
+     */
+    bool getReferenceLocation(LocationPoint& point);
+
+    /**
+     * @brief Get the phase timing of the most recent, or running, GNSS session
+     *
+     * @param timing Timing of each phase
+     * @return true Timing is available
+     * @return false No session has started since startup
+     */
+    bool getLastTiming(LocationTiming& timing);
+
+    /**
+     * @brief Get AT command latency histograms and CME error counters
+     *
+     * @param stats Counters for each kind of AT command sent since startup or the last reset
+     */
+    void getStatistics(LocationAtStatistics& stats) const;
+
+    /**
+     * @brief Clear AT command latency histograms and CME error counters
+     *
+     */
+    void resetStatistics();
+
+    /**
+     * @brief Subscribe to the stream of fixes produced by acquisitions and tracking sessions
+     *
+     * Each subscriber reads at its own pace with readFix().  The GNSS thread never waits for subscribers, fixes a
+     * subscriber does not read before they are overwritten are counted in its overruns field.
+     *
+     * @param backlog Start with the oldest fix still held instead of the next new fix
+     * @return LocationSubscriber Subscriber read position
+     */
+    LocationSubscriber subscribe(bool backlog = false) const {
+        return _fixRing.cursor(backlog);
+    }
+
+    /**
+     * @brief Read the next fix for a subscriber without blocking
+     *
+     * @param subscriber Subscriber read position returned by subscribe()
+     * @param point Location point with position
+     * @return true A fix was read
+     * @return false No new fixes
+     */
+    bool readFix(LocationSubscriber& subscriber, LocationPoint& point) const {
+        return _fixRing.read(subscriber, point);
+    }
+
     /**
      * @brief Get the current acquistion state
      *
@@ -122,6 +304,139 @@ public:
         return (_acquiring.load()) ? LocationResults::Acquiring : LocationResults::Idle;
     }
 
+    /**
+     * @brief Start a tracking session that keeps GNSS running between requests
+     *
+     * While tracking, getLocation() returns the most recent settled fix immediately, or waits for the session to
+     * settle if it has not yet.
+     *
+     * @param intervalMs Time, in milliseconds, between position updates
+     * @param publish Publish every settled fix of the session, see LocationConfiguration::publishBatch()
+     * @retval 0 Success
+     * @retval SYSTEM_ERROR_INVALID_STATE Modem is not on
+     * @retval SYSTEM_ERROR_NOT_SUPPORTED Modem does not support GNSS
+     * @retval SYSTEM_ERROR_BUSY Another command is pending
+     */
+    int startTracking(unsigned int intervalMs = 1000, bool publish = false);
+
+    /**
+     * @brief Stop a tracking session and turn GNSS off
+     *
+     * @retval 0 Success
+     * @retval SYSTEM_ERROR_BUSY Another command is pending
+     */
+    int stopTracking();
+
+    /**
+     * @brief Cancel the acquisition or tracking session in progress
+     *
+     * The acquisition stops at the next poll, GNSS and antenna power are turned off, and waiting requests complete
+     * with LocationResults::Cancelled.
+     *
+     * @retval 0 Success
+     * @retval SYSTEM_ERROR_INVALID_STATE No acquisition or tracking session in progress
+     */
+    int cancel();
+
+    /**
+     * @brief Start acquiring at intervals chosen from the motion of the device
+     *
+     * The first acquisition starts right away.  Each following one is scheduled from the speed, change of heading and
+     * stability of the position of the previous fixes, within the bounds of LocationConfiguration::dutyCycle().
+     * Acquisitions are paused while a tracking session is running.  Fixes are available through subscribe(),
+     * getLastLocation() and getLocation() with a maximum age.
+     *
+     * @param publish Publish every settled fix of the duty cycle
+     * @retval 0 Success
+     * @retval SYSTEM_ERROR_INVALID_STATE Modem is not on
+     * @retval SYSTEM_ERROR_NOT_SUPPORTED Modem does not support GNSS
+     * @retval SYSTEM_ERROR_BUSY Another command is pending
+     */
+    int startDutyCycle(bool publish = false);
+
+    /**
+     * @brief Stop acquiring at intervals, an acquisition in progress completes
+     *
+     * @retval 0 Success
+     * @retval SYSTEM_ERROR_BUSY Another command is pending
+     */
+    int stopDutyCycle();
+
+    /**
+     * @brief Indicate whether the duty cycle is running
+     *
+     * @return true Duty cycle is running
+     * @return false No duty cycle
+     */
+    bool isDutyCycling() const {
+        return _dutyCycling.load();
+    }
+
+    /**
+     * @brief Load an XTRA assistance data file into the modem
+     *
+     * The file must already be in the modem file system, for example "UFS:xtra2.bin".  It is loaded before the next
+     * session starts, or right away if no session is running, and the validity of the loaded data is read back.
+     *
+     * @param filename Name of the file in the modem file system
+     * @retval 0 Success
+     * @retval SYSTEM_ERROR_INVALID_STATE Assistance is not enabled in the configuration
+     * @retval SYSTEM_ERROR_INVALID_ARGUMENT Filename is missing or too long
+     * @retval SYSTEM_ERROR_BUSY Another command is pending
+     */
+    int injectAssistance(const char* filename);
+
+    /**
+     * @brief Get the state of XTRA assistance
+     *
+     * @param assistance State of assistance
+     * @return true Assistance is enabled and its state has been read from the modem
+     * @return false Assistance is not enabled, or the modem has not been queried yet
+     */
+    bool getAssistance(LocationAssistance& assistance);
+
+    /**
+     * @brief Indicate whether new assistance data should be injected
+     *
+     * @return true Assistance is enabled, and no data is loaded or it expires within the configured margin
+     * @return false Assistance is disabled or the loaded data is current
+     */
+    bool isAssistanceDue();
+
+    /**
+     * @brief Report that a cellular transfer is about to start, so that GNSS priority windows end or wait for it
+     *
+     * Each call must be matched by a call to endCellularActivity().
+     *
+     */
+    void beginCellularActivity() {
+        _cellularActivity.fetch_add(1);
+
+        // Wake an acquisition waiting between polls so that a GNSS window is released right away
+        uint8_t wake = 0;
+        os_queue_put(_cancelQueue, &wake, 0, nullptr);
+    }
+
+    /**
+     * @brief Report that a cellular transfer reported with beginCellularActivity() has finished
+     *
+     */
+    void endCellularActivity() {
+        auto count = _cellularActivity.load();
+        while ((0 < count) && !_cellularActivity.compare_exchange_weak(count, count - 1)) {
+        }
+    }
+
+    /**
+     * @brief Indicate whether a tracking session is running
+     *
+     * @return true Tracking session is running
+     * @return false No tracking session
+     */
+    bool isTracking() const {
+        return _tracking.load();
+    }
+
 private:
     enum class _ModemType {
         Unavailable,                    /**< Modem type has not been read yet likely because the modem is off */
@@ -132,33 +447,12 @@ private:
 
     struct QlocContext {
         // QLOC parsed fields
-        unsigned int tm_hour {};
-        unsigned int tm_min {};
-        unsigned int tm_sec {};
-        unsigned int tm_day {};
-        unsigned int tm_month {};
-        unsigned int tm_year {};
-        double latitude {};
-        double longitude {};
-        unsigned int fix {};
-        float hdop {};
-        float altitude {};
-        unsigned int cogDegrees {};
-        unsigned int cogMinutes {};
-        float speedKmph {};
-        float speedKnots {};
-        unsigned int nsat {};
-
-        // Time related
-        std::tm timeinfo = {};
+        LocationQloc fields {};
     };
 
     struct EpeContext {
         // EPE parsed fields
-        float h_acc {};
-        float v_acc {};
-        float speed_acc {};
-        float head_acc {};
+        LocationEpe fields {};
     };
 
     SomLocation();
@@ -172,43 +466,193 @@ private:
     void clearAntennaPower();
 
     bool isModemOn() const {
-        return Cellular.isOn();
+        return _modem->isOn();
     }
 
     bool isConnected() const {
         return Particle.connected();
     }
 
+    bool isCellularBusy() const {
+        return (0 < _cellularActivity.load()) || Cellular.connecting();
+    }
+
+    bool isXtraEnabled() const {
+        // Time can only be injected with XTRA enabled, with or without assistance data
+        return _conf.assistance() || _conf.reference();
+    }
+
     int setConstellationBg95(LocationConstellation flags);
 
     LocationCommandContext waitOnCommandEvent(system_tick_t timeout);
-    LocationResults waitOnResponseEvent(system_tick_t timeout);
     static void stripLfCr(char* str);
-    static int glocCallback(int type, const char* buf, int len, char* locBuffer);
-    static int epeCallback(int type, const char* buf, int len, char* epeBuffer);
+    struct AtCommandContext {
+        SomLocation* self;
+        LocationAtCommand command;
+        LocationModemCallback callback;
+    };
+
+    static void atCommandCallback(LocationModemResponse type, const char* buf, int len, void* param);
+    int atCommand(LocationAtCommand command, const char* line, LocationModemCallback callback = nullptr,
+                  uint32_t timeoutMs = LocationModem::DefaultTimeoutMs);
+    static void pollCallback(LocationModemResponse type, const char* buf, int len, void* param);
+    CME_Error poll(LocationPoint& point);
+    static void nmeaUrcCallback(const char* prefix, const char* line, int len, void* param);
+    bool enableNmeaOutput();
+    void checkNmeaOutput();
+    void disableNmeaOutput();
+    CME_Error waitNmea(LocationPoint& point, system_tick_t timeout);
     CME_Error parseCmeError(const char* buf);
     int parseQloc(const char* buf, QlocContext& context, LocationPoint& point);
     CME_Error parseQlocResponse(const char* buf, QlocContext& context, LocationPoint& point);
     void parseEpeResponse(const char* buf, EpeContext& context, LocationPoint& point);
+    bool isSettled(CME_Error ret, int fixCount, const LocationPoint& point) const;
+    LocationStartType classifyStart();
+    void applyStartPolicy(LocationStartType type);
+    bool waitCancel(system_tick_t timeout);
+    void updateAssistance();
+    void injectAssistanceTime();
+    void queryAssistance();
+    static void assistanceCallback(LocationModemResponse type, const char* buf, int len, void* param);
+    void scheduleRf(bool settled);
+    void setRfOwner(LocationRfOwner owner);
+    void startSession();
+    void endSession();
+    LocationResults acquire(LocationPoint& point);
+    void startTrackingSession(unsigned int intervalMs, bool publish);
+    void stopTrackingSession(LocationResults response);
+    void trackingPoll();
+    bool readTrackedPoint(LocationPoint& point);
+    void startDutyCycleSession(bool publish);
+    void dutyCycleAcquire();
+    void scheduleDutyCycle(LocationResults response, const LocationPoint& point);
+    void saveLastFix(const LocationPoint& point);
+    void loadReference();
+    void saveReference();
+    void recordPoll(uint64_t sent);
+    void saveTiming();
+    bool readLastFix(LocationPoint& point, std::chrono::milliseconds maximumAge);
+    void publishLocation(const LocationPoint& point);
+    void batchLocation(const LocationPoint& point);
+    bool flushBatch();
+    void spillBatch();
+    void checkBatchAge();
+    void storeLocation(const LocationPoint& point);
+    void replayStored();
+    int addWaiter(const LocationWaiter& waiter);
+    bool removeWaiter(int index, os_semaphore_t done);
+    bool completeWaiters(LocationResults response, const LocationPoint& point);
     void threadLoop();
-    size_t buildPublish(char* buffer, size_t len, LocationPoint& point, unsigned int seq);
+    size_t buildPublish(char* buffer, size_t len, const LocationPoint& point, unsigned int seq);
+    size_t buildPublishPacked(char* buffer, size_t len, const LocationPoint& point, unsigned int seq);
+    static void packFix(const LocationPoint& point, unsigned int seq, LocationPackedFix& fix);
+    static void unpackFix(const LocationPackedFix& fix, LocationPoint& point);
+
+    static constexpr size_t LOCATION_MAX_WAITERS {4};
 
     static SomLocation* _instance;
     os_queue_t _commandQueue;
-    os_queue_t _responseQueue;
+    os_queue_t _nmeaQueue;
+    os_queue_t _cancelQueue;
     Thread* _thread;
     std::atomic<bool> _acquiring{false};
+    std::atomic<bool> _cancel{false};
+    Mutex _waiterMutex;
+    LocationWaiter _waiters[LOCATION_MAX_WAITERS];
+    LocationPoint _acquirePoint {};
+    LocationRing<LocationPoint, LOCATION_FIX_RING_SIZE> _fixRing;
     char _locBuffer[256];
     char _epeBuffer[256];
     QlocContext _qlocContext {};
     EpeContext _epeContext {};
+    LocationPollScheduler _pollScheduler {};
+    LocationAtStats _atStats;
+    Mutex _nmeaMutex;
+    LocationNmeaParser _nmea;
+    time_t _nmeaEpoch {};
+    bool _nmeaUrcRegistered {false};
+    std::atomic<bool> _nmeaSeen {false};
+    uint64_t _nmeaEnabled {};
+    bool _nmeaUnavailable {false};  // Modem gave no NMEA output, poll in every session until the modem changes
+    bool _push {false};
+
+    // Start type of the session in progress and the parameters chosen for it
+    LocationStartType _startType {LocationStartType::Unknown};
+    int _settlingCount {2};
+    unsigned int _sessionPollInterval {};
+    unsigned int _sessionFixSeconds {};
+
+    // RF sharing between GNSS and cellular, the owner is only changed by the GNSS thread
+    LocationRfScheduler _rfScheduler;
+    LocationRfOwner _rfOwner {LocationRfOwner::Cellular};
+    std::atomic<int> _cellularActivity {0};
+
+    // Phase timing of the session in progress, and of the latest session for application threads
+    LocationTiming _sessionTiming {};
+    uint64_t _sessionStart {};
+    Mutex _timingMutex;
+    LocationTiming _lastTiming {};
+    bool _lastTimingValid {false};
+
+    // XTRA assistance, the filename and state are shared with application threads
+    Mutex _assistanceMutex;
+    char _assistanceFile[64] {};
+    bool _assistancePending {false};
+    bool _assistanceConfigured {false};
+    uint64_t _assistanceRetry {};
+    system_tick_t _assistanceBackoff {};
+    LocationAssistance _assistance {};
+    bool _assistanceKnown {false};
+
+    // Tracking session state, the settled point is shared with application threads
+    std::atomic<bool> _tracking{false};
+    Mutex _trackMutex;
+    LocationPoint _trackPoint {};
+    bool _trackSettled {false};
+    LocationPoint _trackWork {};
+    unsigned int _trackInterval {};
+    uint64_t _trackStart {};
+    uint64_t _trackNextPoll {};
+    uint64_t _trackFirstFix {};
+    int _trackFixCount {};
+    uint64_t _trackRequestStart {};
+    bool _trackPublish {false};
+
+    // Motion adaptive duty cycle, only used by the GNSS thread apart from the running flag
+    std::atomic<bool> _dutyCycling{false};
+    LocationDutyScheduler _dutyScheduler;
+    uint64_t _dutyNext {};
+    bool _dutyPublish {false};
 
     LocationConfiguration _conf;
+    LocationCellularModem _cellularModem;
+    LocationModem* _modem {&_cellularModem};
     pin_t _antennaPowerPin {PIN_INVALID};
     _ModemType _modemType {_ModemType::Unavailable};
 
+    // Last settled position, shared with application threads
+    Mutex _lastFixMutex;
+    LocationPoint _lastFix {};
+    uint64_t _lastFixMillis {};
+    bool _lastFixValid {false};
+    LocationPoint _referenceFix {};     // Last settled position, persisted per session and periodically while tracking
+    bool _referenceValid {false};
+    bool _referenceDirty {false};
+    uint64_t _referenceSaved {};
+
+    Mutex _publishMutex;
     char _publishBuffer[particle::protocol::MAX_EVENT_DATA_LENGTH];
     unsigned int _reqid {1};
+
+    // Fixes waiting to be published as one event, sized so that the base64 text fits an event
+    LocationBatchEncoder _batch;
+    uint8_t _batchBuffer[(particle::protocol::MAX_EVENT_DATA_LENGTH - 1) / 4 * 3];
+    uint64_t _batchStart {};
+
+    // Fixes kept while offline
+    LocationStore _store;
+    uint64_t _nextReplay {};
+    unsigned int _replayed {};
 };
 
 #define Location SomLocation::instance()
@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+
+#include "location_encode.h"
+
+namespace {
+
+const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr uint8_t PACKED_FLAG_LOCKED {1 << 0};
+constexpr unsigned int PACKED_START_SHIFT {1};
+constexpr uint8_t PACKED_START_MASK {0x3};
+constexpr unsigned int TRACK_MAX_PRECISION {7};
+constexpr size_t TRACK_MAX_VALUE_SIZE {7};     // 32 bits in 5 bit polyline chunks
+constexpr uint8_t POLYLINE_OFFSET {63};
+constexpr uint8_t POLYLINE_MORE {0x20};
+
+// Units of 1e-7 degrees in one unit of each precision
+constexpr int32_t TRACK_SCALE[TRACK_MAX_PRECISION + 1] = {10000000, 1000000, 100000, 10000, 1000, 100, 10, 1};
+
+unsigned int trackPrecision(unsigned int precision) {
+    return (1 > precision) ? 1 : ((TRACK_MAX_PRECISION < precision) ? TRACK_MAX_PRECISION : precision);
+}
+
+} // anonymous namespace
+
+uint8_t* LocationEncoder::put16(uint8_t* p, uint16_t value) {
+    *p++ = (uint8_t)value;
+    *p++ = (uint8_t)(value >> 8);
+    return p;
+}
+
+uint8_t* LocationEncoder::put32(uint8_t* p, uint32_t value) {
+    p = put16(p, (uint16_t)value);
+    return put16(p, (uint16_t)(value >> 16));
+}
+
+uint16_t LocationEncoder::get16(const uint8_t* p) {
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+uint32_t LocationEncoder::get32(const uint8_t* p) {
+    return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+size_t LocationEncoder::pack(const LocationPackedFix& fix, uint8_t* buffer, size_t size) {
+    if (size < PackedSize) {
+        return 0;
+    }
+
+    auto p = buffer;
+    *p++ = PackedVersion;
+    *p++ = ((fix.locked) ? PACKED_FLAG_LOCKED : 0) | ((fix.startType & PACKED_START_MASK) << PACKED_START_SHIFT);
+    p = put32(p, fix.reqId);
+    p = put32(p, fix.systemTime);
+    p = put32(p, fix.epochTime);
+    p = put32(p, (uint32_t)fix.latitude);
+    p = put32(p, (uint32_t)fix.longitude);
+    p = put32(p, (uint32_t)fix.altitude);
+    p = put16(p, fix.heading);
+    p = put16(p, fix.speed);
+    p = put16(p, fix.horizontalDop);
+    p = put16(p, fix.horizontalAccuracy);
+    p = put16(p, fix.verticalAccuracy);
+    *p++ = fix.satsInUse;
+    p = put16(p, fix.timeToFirstFix);
+
+    return (size_t)(p - buffer);
+}
+
+int LocationEncoder::unpack(const uint8_t* data, size_t len, LocationPackedFix& fix) {
+    if ((len < PackedSize) || (PackedVersion != data[0])) {
+        return -1;
+    }
+
+    fix.locked = (data[1] & PACKED_FLAG_LOCKED);
+    fix.startType = (data[1] >> PACKED_START_SHIFT) & PACKED_START_MASK;
+    fix.reqId = get32(data + 2);
+    fix.systemTime = get32(data + 6);
+    fix.epochTime = get32(data + 10);
+    fix.latitude = (int32_t)get32(data + 14);
+    fix.longitude = (int32_t)get32(data + 18);
+    fix.altitude = (int32_t)get32(data + 22);
+    fix.heading = get16(data + 26);
+    fix.speed = get16(data + 28);
+    fix.horizontalDop = get16(data + 30);
+    fix.horizontalAccuracy = get16(data + 32);
+    fix.verticalAccuracy = get16(data + 34);
+    fix.satsInUse = data[36];
+    fix.timeToFirstFix = get16(data + 37);
+
+    return 0;
+}
+
+size_t LocationEncoder::base64Encode(const uint8_t* data, size_t len, char* text, size_t size) {
+    auto required = ((len + 2) / 3) * 4;
+    if (size < required + 1) {
+        return 0;
+    }
+
+    auto out = text;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t group = (uint32_t)data[i] << 16;
+        if ((i + 1) < len) {
+            group |= (uint32_t)data[i + 1] << 8;
+        }
+        if ((i + 2) < len) {
+            group |= data[i + 2];
+        }
+        *out++ = BASE64_ALPHABET[(group >> 18) & 0x3f];
+        *out++ = BASE64_ALPHABET[(group >> 12) & 0x3f];
+        *out++ = ((i + 1) < len) ? BASE64_ALPHABET[(group >> 6) & 0x3f] : '=';
+        *out++ = ((i + 2) < len) ? BASE64_ALPHABET[group & 0x3f] : '=';
+    }
+    *out = '\0';
+
+    return required;
+}
+
+int LocationEncoder::base64Value(char c) {
+    if (('A' <= c) && ('Z' >= c)) {
+        return c - 'A';
+    }
+    if (('a' <= c) && ('z' >= c)) {
+        return c - 'a' + 26;
+    }
+    if (('0' <= c) && ('9' >= c)) {
+        return c - '0' + 52;
+    }
+    if ('+' == c) {
+        return 62;
+    }
+    if ('/' == c) {
+        return 63;
+    }
+    return -1;
+}
+
+int LocationEncoder::base64Decode(const char* text, size_t len, uint8_t* data, size_t size) {
+    if (len % 4) {
+        return -1;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < len; i += 4) {
+        uint32_t group = 0;
+        int padding = 0;
+        for (size_t j = 0; j < 4; j++) {
+            auto c = text[i + j];
+            // Padding is only allowed in the last two positions of the final group
+            if (('=' == c) && ((i + 4) == len) && (2 <= j)) {
+                padding++;
+                group <<= 6;
+                continue;
+            }
+            auto value = base64Value(c);
+            if ((0 > value) || padding) {
+                return -1;
+            }
+            group = (group << 6) | (uint32_t)value;
+        }
+
+        auto bytes = 3 - padding;
+        if ((count + bytes) > size) {
+            return -1;
+        }
+        data[count++] = (uint8_t)(group >> 16);
+        if (1 < bytes) {
+            data[count++] = (uint8_t)(group >> 8);
+        }
+        if (2 < bytes) {
+            data[count++] = (uint8_t)group;
+        }
+    }
+
+    return (int)count;
+}
+
+uint8_t* LocationEncoder::putVarint(uint8_t* p, uint32_t value) {
+    while (0x80 <= value) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+int LocationEncoder::getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p >= end) {
+            return -1;
+        }
+        auto byte = *p++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void LocationBatchEncoder::fields(const LocationPackedFix& fix, int32_t (&values)[Fields]) {
+    values[0] = (int32_t)fix.epochTime;
+    values[1] = fix.latitude;
+    values[2] = fix.longitude;
+    values[3] = fix.altitude;
+    values[4] = fix.heading;
+    values[5] = fix.speed;
+    values[6] = fix.horizontalDop;
+    values[7] = fix.horizontalAccuracy;
+    values[8] = fix.verticalAccuracy;
+    values[9] = fix.satsInUse;
+}
+
+void LocationBatchEncoder::clear() {
+    _size = HeaderSize;
+    _count = 0;
+    for (auto& previous : _previous) {
+        previous = 0;
+    }
+}
+
+bool LocationBatchEncoder::add(const LocationPackedFix& fix) {
+    if (!_buffer || (MaxFixes <= _count)) {
+        return false;
+    }
+
+    int32_t values[Fields];
+    fields(fix, values);
+
+    uint8_t encoded[MaxFixSize];
+    auto p = encoded;
+    for (size_t i = 0; i < Fields; i++) {
+        // Wrapping difference so that any pair of values round trips
+        p = LocationEncoder::putVarint(p, LocationEncoder::zigzag((int32_t)((uint32_t)values[i] - (uint32_t)_previous[i])));
+    }
+    auto len = (size_t)(p - encoded);
+    if ((_size + len) > _capacity) {
+        return false;
+    }
+
+    memcpy(_buffer + _size, encoded, len);
+    _size += len;
+    _count++;
+    memcpy(_previous, values, sizeof(_previous));
+
+    _buffer[0] = BatchVersion;
+    _buffer[1] = (uint8_t)_count;
+    return true;
+}
+
+int LocationBatchEncoder::decode(const uint8_t* data, size_t len, LocationPackedFix* fixes, size_t maxFixes) {
+    if ((HeaderSize > len) || (data[1] > maxFixes)) {
+        return -1;
+    }
+
+    auto next = fixes;
+    return decode(data, len, [](const LocationPackedFix& fix, void* param) {
+        *(*static_cast<LocationPackedFix**>(param))++ = fix;
+    }, &next);
+}
+
+int LocationBatchEncoder::decode(const uint8_t* data, size_t len,
+                                 void (*callback)(const LocationPackedFix& fix, void* param), void* param) {
+    if ((HeaderSize > len) || (BatchVersion != data[0])) {
+        return -1;
+    }
+
+    size_t count = data[1];
+    auto p = data + HeaderSize;
+    auto end = data + len;
+    int32_t values[Fields] {};
+    for (size_t n = 0; n < count; n++) {
+        for (auto& value : values) {
+            uint32_t delta;
+            if (LocationEncoder::getVarint(p, end, delta)) {
+                return -1;
+            }
+            value = (int32_t)((uint32_t)value + (uint32_t)LocationEncoder::unzigzag(delta));
+        }
+
+        LocationPackedFix fix {};
+        fix.locked = true;
+        fix.epochTime = (uint32_t)values[0];
+        fix.latitude = values[1];
+        fix.longitude = values[2];
+        fix.altitude = values[3];
+        fix.heading = (uint16_t)values[4];
+        fix.speed = (uint16_t)values[5];
+        fix.horizontalDop = (uint16_t)values[6];
+        fix.horizontalAccuracy = (uint16_t)values[7];
+        fix.verticalAccuracy = (uint16_t)values[8];
+        fix.satsInUse = (uint8_t)values[9];
+        callback(fix, param);
+    }
+
+    return (int)count;
+}
+
+int32_t LocationTrackEncoder::quantize(int32_t value, unsigned int precision) {
+    auto scale = TRACK_SCALE[trackPrecision(precision)];
+    auto half = scale / 2;
+    return (0 > value) ? -(int32_t)(((int64_t)-value + half) / scale) : (int32_t)(((int64_t)value + half) / scale);
+}
+
+uint8_t* LocationTrackEncoder::putValue(uint8_t* p, int32_t value, LocationTrackFormat format) {
+    auto zigzag = LocationEncoder::zigzag(value);
+    if (LocationTrackFormat::Binary == format) {
+        return LocationEncoder::putVarint(p, zigzag);
+    }
+
+    while (POLYLINE_MORE <= zigzag) {
+        *p++ = (uint8_t)((POLYLINE_MORE | (zigzag & 0x1f)) + POLYLINE_OFFSET);
+        zigzag >>= 5;
+    }
+    *p++ = (uint8_t)(zigzag + POLYLINE_OFFSET);
+    return p;
+}
+
+void LocationTrackEncoder::begin(uint8_t* buffer, size_t size, unsigned int precision, LocationTrackFormat format,
+                                 bool time) {
+    _buffer = buffer;
+    _capacity = size;
+    _precision = trackPrecision(precision);
+    _format = format;
+    _time = time;
+    clear();
+}
+
+void LocationTrackEncoder::clear() {
+    _size = 0;
+    _count = 0;
+    _latitude = 0;
+    _longitude = 0;
+    _timestamp = 0;
+    if (_buffer && _capacity && (LocationTrackFormat::Text == _format)) {
+        _buffer[0] = '\0';
+    }
+}
+
+bool LocationTrackEncoder::add(int32_t latitude, int32_t longitude, uint32_t time) {
+    if (!_buffer) {
+        return false;
+    }
+
+    latitude = quantize(latitude, _precision);
+    longitude = quantize(longitude, _precision);
+
+    uint8_t encoded[3 * TRACK_MAX_VALUE_SIZE];
+    auto p = putValue(encoded, (int32_t)((uint32_t)latitude - (uint32_t)_latitude), _format);
+    p = putValue(p, (int32_t)((uint32_t)longitude - (uint32_t)_longitude), _format);
+    if (_time) {
+        p = putValue(p, (int32_t)(time - _timestamp), _format);
+    }
+
+    auto len = (size_t)(p - encoded);
+    auto terminator = (LocationTrackFormat::Text == _format) ? 1 : 0;
+    if ((_size + len + terminator) > _capacity) {
+        return false;
+    }
+
+    memcpy(_buffer + _size, encoded, len);
+    _size += len;
+    if (terminator) {
+        _buffer[_size] = '\0';
+    }
+    _count++;
+    _latitude = latitude;
+    _longitude = longitude;
+    _timestamp = time;
+    return true;
+}
+
+void LocationTrackDecoder::begin(const uint8_t* data, size_t len, unsigned int precision, LocationTrackFormat format,
+                                 bool time) {
+    _p = data;
+    _end = data + len;
+    _precision = trackPrecision(precision);
+    _format = format;
+    _time = time;
+    _error = false;
+    _latitude = 0;
+    _longitude = 0;
+    _timestamp = 0;
+}
+
+bool LocationTrackDecoder::getValue(int32_t& value) {
+    uint32_t zigzag = 0;
+    if (LocationTrackFormat::Binary == _format) {
+        if (LocationEncoder::getVarint(_p, _end, zigzag)) {
+            return false;
+        }
+    }
+    else {
+        for (int shift = 0;; shift += 5) {
+            if ((_p >= _end) || (35 <= shift) || (POLYLINE_OFFSET > *_p) || ((POLYLINE_OFFSET + 0x3f) < *_p)) {
+                return false;
+            }
+            auto chunk = (uint32_t)(*_p++ - POLYLINE_OFFSET);
+            zigzag |= (chunk & 0x1f) << shift;
+            if (!(chunk & POLYLINE_MORE)) {
+                break;
+            }
+        }
+    }
+
+    value = LocationEncoder::unzigzag(zigzag);
+    return true;
+}
+
+bool LocationTrackDecoder::next(int32_t& latitude, int32_t& longitude, uint32_t& time) {
+    if (_error || (_p >= _end)) {
+        return false;
+    }
+
+    int32_t deltaLatitude;
+    int32_t deltaLongitude;
+    int32_t deltaTime = 0;
+    if (!getValue(deltaLatitude) || !getValue(deltaLongitude) || (_time && !getValue(deltaTime))) {
+        _error = true;
+        return false;
+    }
+
+    _latitude = (int32_t)((uint32_t)_latitude + (uint32_t)deltaLatitude);
+    _longitude = (int32_t)((uint32_t)_longitude + (uint32_t)deltaLongitude);
+    _timestamp += (uint32_t)deltaTime;
+
+    auto scale = TRACK_SCALE[_precision];
+    latitude = _latitude * scale;
+    longitude = _longitude * scale;
+    time = (_time) ? _timestamp : 0;
+    return true;
+}
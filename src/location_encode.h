@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Location event fields in the integer units of the packed encoding
+ *
+ */
+struct LocationPackedFix {
+    uint32_t reqId;                 /**< Request sequence number */
+    uint32_t systemTime;            /**< System epoch time, 0 if unknown */
+    bool locked;                    /**< Position is fixed, the remaining fields are zero otherwise */
+    uint32_t epochTime;             /**< GNSS epoch time */
+    int32_t latitude;               /**< Latitude in 1e-7 degrees */
+    int32_t longitude;              /**< Longitude in 1e-7 degrees */
+    int32_t altitude;               /**< Altitude in millimeters */
+    uint16_t heading;               /**< Heading in hundredths of degrees */
+    uint16_t speed;                 /**< Speed in hundredths of meters per second */
+    uint16_t horizontalDop;         /**< Horizontal dilution of precision in tenths */
+    uint16_t horizontalAccuracy;    /**< Horizontal accuracy in centimeters, 0 if unknown */
+    uint16_t verticalAccuracy;      /**< Vertical accuracy in centimeters, 0 if unknown */
+    uint8_t satsInUse;              /**< Satellites in use */
+    uint16_t timeToFirstFix;        /**< Time to first fix in tenths of seconds */
+    uint8_t startType;              /**< Receiver start type, 0 unknown, 1 hot, 2 warm, 3 cold */
+};
+
+/**
+ * @brief Packed binary encoding of location events
+ *
+ * Each event is a fixed 39 byte little endian record, wrapped in base64 for the text event channel:
+ *
+ * | Offset | Size | Field                                  |
+ * |--------|------|----------------------------------------|
+ * | 0      | 1    | Version, currently 1                   |
+ * | 1      | 1    | Flags, bit 0 locked, bits 1-2 start    |
+ * | 2      | 4    | reqId                                  |
+ * | 6      | 4    | systemTime                             |
+ * | 10     | 4    | epochTime                              |
+ * | 14     | 4    | latitude                               |
+ * | 18     | 4    | longitude                              |
+ * | 22     | 4    | altitude                               |
+ * | 26     | 2    | heading                                |
+ * | 28     | 2    | speed                                  |
+ * | 30     | 2    | horizontalDop                          |
+ * | 32     | 2    | horizontalAccuracy                     |
+ * | 34     | 2    | verticalAccuracy                       |
+ * | 36     | 1    | satsInUse                              |
+ * | 37     | 2    | timeToFirstFix                         |
+ *
+ * The encoder has no platform dependencies so that the decoder can be built into host tools.
+ *
+ */
+class LocationEncoder {
+public:
+    static constexpr uint8_t PackedVersion {1};            /**< Version of the packed layout */
+    static constexpr size_t PackedSize {39};               /**< Bytes in a packed record */
+    static constexpr size_t PackedTextSize {((PackedSize + 2) / 3) * 4 + 1};  /**< Base64 characters plus terminator */
+
+    /**
+     * @brief Pack a location event
+     *
+     * @param fix Event fields
+     * @param buffer Destination
+     * @param size Size of destination
+     * @return size_t Bytes written, 0 if the destination is too small
+     */
+    static size_t pack(const LocationPackedFix& fix, uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Unpack a location event
+     *
+     * @param data Packed record
+     * @param len Length of packed record
+     * @param fix Event fields
+     * @retval 0 Success
+     * @retval -1 Record is truncated or of an unknown version
+     */
+    static int unpack(const uint8_t* data, size_t len, LocationPackedFix& fix);
+
+    /**
+     * @brief Encode bytes as null terminated base64 text
+     *
+     * @param data Bytes to encode
+     * @param len Number of bytes
+     * @param text Destination
+     * @param size Size of destination, including the terminator
+     * @return size_t Characters written excluding the terminator, 0 if the destination is too small
+     */
+    static size_t base64Encode(const uint8_t* data, size_t len, char* text, size_t size);
+
+    /**
+     * @brief Decode base64 text
+     *
+     * @param text Text to decode
+     * @param len Number of characters
+     * @param data Destination
+     * @param size Size of destination
+     * @return int Bytes written, or -1 if the text is malformed or the destination too small
+     */
+    static int base64Decode(const char* text, size_t len, uint8_t* data, size_t size);
+
+    /**
+     * @brief Map a signed value onto an unsigned one so that small magnitudes stay small
+     *
+     * @param value Signed value
+     * @return uint32_t Zigzag encoded value
+     */
+    static constexpr uint32_t zigzag(int32_t value) {
+        return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    }
+
+    /**
+     * @brief Reverse zigzag()
+     *
+     * @param value Zigzag encoded value
+     * @return int32_t Signed value
+     */
+    static constexpr int32_t unzigzag(uint32_t value) {
+        return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    }
+
+    /**
+     * @brief Write an unsigned LEB128 varint, at most 5 bytes
+     *
+     * @param p Destination
+     * @param value Value to write
+     * @return uint8_t* Position after the varint
+     */
+    static uint8_t* putVarint(uint8_t* p, uint32_t value);
+
+    /**
+     * @brief Read an unsigned LEB128 varint
+     *
+     * @param p Position of the varint, advanced past it
+     * @param end End of data
+     * @param value Value read
+     * @retval 0 Success
+     * @retval -1 Varint is truncated or longer than 5 bytes
+     */
+    static int getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value);
+
+private:
+    static uint8_t* put16(uint8_t* p, uint16_t value);
+    static uint8_t* put32(uint8_t* p, uint32_t value);
+    static uint16_t get16(const uint8_t* p);
+    static uint32_t get32(const uint8_t* p);
+    static int base64Value(char c);
+};
+
+/**
+ * @brief Delta encoded batch of location fixes
+ *
+ * A batch starts with a version byte, currently 2, and a count byte.  Each fix follows as ten zigzag varints holding
+ * the difference of epochTime, latitude, longitude, altitude, heading, speed, horizontalDop, horizontalAccuracy,
+ * verticalAccuracy and satsInUse from the previous fix, the first fix being relative to zero.  Consecutive fixes of a
+ * track mostly differ by a few units so each typically takes 10 to 16 bytes instead of 39.
+ *
+ */
+class LocationBatchEncoder {
+public:
+    static constexpr uint8_t BatchVersion {2};             /**< Version of the batch layout */
+    static constexpr size_t HeaderSize {2};                /**< Bytes before the first fix */
+    static constexpr size_t MaxFixSize {10 * 5};           /**< Largest possible encoded fix */
+    static constexpr size_t MaxFixes {255};                /**< Most fixes in one batch */
+
+    /**
+     * @brief Start an empty batch in the given storage
+     *
+     * @param buffer Storage for the encoded batch, which must remain valid while in use
+     * @param size Size of storage
+     */
+    void begin(uint8_t* buffer, size_t size) {
+        _buffer = buffer;
+        _capacity = size;
+        clear();
+    }
+
+    /**
+     * @brief Discard all fixes
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Append a fix
+     *
+     * @param fix Fix to append, reqId, systemTime, locked and timeToFirstFix are not batched
+     * @return true Fix was appended
+     * @return false Batch is full
+     */
+    bool add(const LocationPackedFix& fix);
+
+    /**
+     * @brief Get the encoded batch
+     *
+     * @return const uint8_t* Encoded batch
+     */
+    const uint8_t* data() const {
+        return _buffer;
+    }
+
+    /**
+     * @brief Get the size of the encoded batch
+     *
+     * @return size_t Bytes, 0 while the batch is empty
+     */
+    size_t size() const {
+        return (_count) ? _size : 0;
+    }
+
+    /**
+     * @brief Get the number of fixes in the batch
+     *
+     * @return size_t Number of fixes
+     */
+    size_t count() const {
+        return _count;
+    }
+
+    /**
+     * @brief Decode a batch
+     *
+     * @param data Encoded batch
+     * @param len Length of encoded batch
+     * @param fixes Decoded fixes, with locked set
+     * @param maxFixes Number of entries in fixes
+     * @return int Number of fixes decoded, or -1 if the batch is malformed or has more than maxFixes
+     */
+    static int decode(const uint8_t* data, size_t len, LocationPackedFix* fixes, size_t maxFixes);
+
+    /**
+     * @brief Decode a batch one fix at a time
+     *
+     * @param data Encoded batch
+     * @param len Length of encoded batch
+     * @param callback Called with each decoded fix, with locked set
+     * @param param Passed to the callback
+     * @return int Number of fixes decoded, or -1 if the batch is malformed
+     */
+    static int decode(const uint8_t* data, size_t len, void (*callback)(const LocationPackedFix& fix, void* param),
+                      void* param);
+
+private:
+    static constexpr size_t Fields {10};
+
+    static void fields(const LocationPackedFix& fix, int32_t (&values)[Fields]);
+
+    uint8_t* _buffer {nullptr};
+    size_t _capacity {};
+    size_t _size {};
+    size_t _count {};
+    int32_t _previous[Fields] {};
+};
+
+/**
+ * @brief Digit encodings of a LocationTrackEncoder track
+ *
+ */
+enum class LocationTrackFormat {
+    Binary,                 /**< LEB128 varints, 7 bits per byte */
+    Text,                   /**< Encoded polyline characters, 5 bits per printable character, null terminated */
+};
+
+/**
+ * @brief Streaming encoder of tracks as quantized, delta, zigzag and varint encoded points
+ *
+ * Coordinates are rounded to the configured number of decimal digits of degrees, and each point is stored as the
+ * zigzag varint difference of latitude, longitude and optionally time from the previous point.  With the text format
+ * and a precision of 5 the output is the widely supported encoded polyline algorithm format.  Neighbouring points of
+ * a dense track typically take 4 to 6 bytes.
+ *
+ */
+class LocationTrackEncoder {
+public:
+    /**
+     * @brief Start an empty track in the given storage
+     *
+     * @param buffer Storage for the encoded track, which must remain valid while in use
+     * @param size Size of storage
+     * @param precision Decimal digits of degrees kept, 1 to 7
+     * @param format Digit encoding
+     * @param time Include time with each point
+     */
+    void begin(uint8_t* buffer, size_t size, unsigned int precision = 5,
+               LocationTrackFormat format = LocationTrackFormat::Binary, bool time = false);
+
+    /**
+     * @brief Discard all points
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Append a point
+     *
+     * @param latitude Latitude in 1e-7 degrees
+     * @param longitude Longitude in 1e-7 degrees
+     * @param time Time of the point, ignored unless the track includes time
+     * @return true Point was appended
+     * @return false Track is full
+     */
+    bool add(int32_t latitude, int32_t longitude, uint32_t time = 0);
+
+    /**
+     * @brief Get the encoded track
+     *
+     * @return const uint8_t* Encoded track
+     */
+    const uint8_t* data() const {
+        return _buffer;
+    }
+
+    /**
+     * @brief Get the size of the encoded track
+     *
+     * @return size_t Bytes, excluding the terminator of the text format
+     */
+    size_t size() const {
+        return _size;
+    }
+
+    /**
+     * @brief Get the number of points in the track
+     *
+     * @return size_t Number of points
+     */
+    size_t count() const {
+        return _count;
+    }
+
+    /**
+     * @brief Round a coordinate to the given precision
+     *
+     * @param value Coordinate in 1e-7 degrees
+     * @param precision Decimal digits of degrees kept
+     * @return int32_t Coordinate in units of the precision
+     */
+    static int32_t quantize(int32_t value, unsigned int precision);
+
+    /**
+     * @brief Write a zigzag encoded value in the given format
+     *
+     * @param p Destination, at least 7 bytes
+     * @param value Value to write
+     * @param format Digit encoding
+     * @return uint8_t* Position after the value
+     */
+    static uint8_t* putValue(uint8_t* p, int32_t value, LocationTrackFormat format);
+
+private:
+    uint8_t* _buffer {nullptr};
+    size_t _capacity {};
+    size_t _size {};
+    size_t _count {};
+    unsigned int _precision {5};
+    LocationTrackFormat _format {LocationTrackFormat::Binary};
+    bool _time {false};
+    int32_t _latitude {};
+    int32_t _longitude {};
+    uint32_t _timestamp {};
+};
+
+/**
+ * @brief Streaming decoder of tracks produced by LocationTrackEncoder
+ *
+ */
+class LocationTrackDecoder {
+public:
+    /**
+     * @brief Start decoding a track
+     *
+     * @param data Encoded track
+     * @param len Length of encoded track, excluding any terminator
+     * @param precision Decimal digits of degrees the track was encoded with
+     * @param format Digit encoding the track was encoded with
+     * @param time Track includes time
+     */
+    void begin(const uint8_t* data, size_t len, unsigned int precision = 5,
+               LocationTrackFormat format = LocationTrackFormat::Binary, bool time = false);
+
+    /**
+     * @brief Decode the next point
+     *
+     * @param latitude Latitude in 1e-7 degrees
+     * @param longitude Longitude in 1e-7 degrees
+     * @param time Time of the point, 0 if the track does not include time
+     * @return true A point was decoded
+     * @return false End of track, or the track is malformed
+     */
+    bool next(int32_t& latitude, int32_t& longitude, uint32_t& time);
+
+    /**
+     * @brief Indicate whether decoding stopped on malformed data
+     *
+     * @return true Track is malformed
+     * @return false Track is well formed so far
+     */
+    bool error() const {
+        return _error;
+    }
+
+private:
+    bool getValue(int32_t& value);
+
+    const uint8_t* _p {nullptr};
+    const uint8_t* _end {nullptr};
+    unsigned int _precision {5};
+    LocationTrackFormat _format {LocationTrackFormat::Binary};
+    bool _time {false};
+    bool _error {false};
+    int32_t _latitude {};
+    int32_t _longitude {};
+    uint32_t _timestamp {};
+};
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Modem hardware as far as GNSS support is concerned
+ *
+ */
+enum class LocationModemDevice {
+    Unknown,                /**< Modem has not been identified yet */
+    Bg95M5,                 /**< Quectel BG95-M5 */
+    Other,                  /**< Modem without supported GNSS */
+};
+
+/**
+ * @brief Type of a line received in response to an AT command
+ *
+ */
+enum class LocationModemResponse {
+    Ok,                     /**< Final OK */
+    Error,                  /**< Final ERROR or +CME ERROR, which also aborts the rest of a concatenated command */
+    Plus,                   /**< Information response starting with '+' */
+    Text,                   /**< Any other information response */
+};
+
+/**
+ * @brief Callback for each line received in response to an AT command
+ *
+ * @param type Type of line
+ * @param buf Line received, which may include line endings and is not necessarily null terminated
+ * @param len Length of line
+ * @param param Parameter given with the command
+ */
+typedef void (*LocationModemCallback)(LocationModemResponse type, const char* buf, int len, void* param);
+
+/**
+ * @brief Callback for an unsolicited result code
+ *
+ * @param prefix Prefix that the result code was matched on
+ * @param line Remainder of the line following the prefix
+ * @param len Length of line
+ * @param param Parameter given when the handler was added
+ */
+typedef void (*LocationModemUrcCallback)(const char* prefix, const char* line, int len, void* param);
+
+/**
+ * @brief AT command transport used by SomLocation to talk to the GNSS receiver
+ *
+ * The library uses the Device OS cellular modem by default.  Other implementations, such as LocationSimulatedModem,
+ * are given to SomLocation::begin() to run the acquisition logic against recorded or synthetic receiver behaviour.
+ *
+ */
+class LocationModem {
+public:
+    virtual ~LocationModem() = default;
+
+    /**
+     * @brief Indicate whether the modem is powered on
+     *
+     * @return true Modem is on
+     * @return false Modem is off
+     */
+    virtual bool isOn() = 0;
+
+    /**
+     * @brief Identify the modem
+     *
+     * @return LocationModemDevice Modem hardware, or LocationModemDevice::Unknown if it cannot be identified yet
+     */
+    virtual LocationModemDevice device() = 0;
+
+    /**
+     * @brief Send an AT command and wait for its final response
+     *
+     * @param callback Callback for each response line, may be null
+     * @param param Parameter passed to the callback
+     * @param timeoutMs Time to wait for the final response
+     * @param command Command line, without line ending
+     * @retval 0 Final response was OK
+     * @retval -1 Final response was an error or the command timed out
+     */
+    virtual int command(LocationModemCallback callback, void* param, uint32_t timeoutMs, const char* command) = 0;
+
+    /**
+     * @brief Send an AT command, ignoring response lines
+     *
+     * @param command Command line, without line ending
+     * @retval 0 Final response was OK
+     * @retval -1 Final response was an error or the command timed out
+     */
+    int command(const char* command) {
+        return this->command(nullptr, nullptr, DefaultTimeoutMs, command);
+    }
+
+    /**
+     * @brief Handle unsolicited result codes starting with the given prefix
+     *
+     * @param prefix Prefix to match, which must remain valid while the handler is installed
+     * @param callback Callback for each matching line
+     * @param param Parameter passed to the callback
+     * @retval 0 Success
+     * @retval -1 Handler could not be added
+     */
+    virtual int addUrcHandler(const char* prefix, LocationModemUrcCallback callback, void* param) = 0;
+
+    static constexpr uint32_t DefaultTimeoutMs {10 * 1000};  /**< Timeout for commands given without one */
+};
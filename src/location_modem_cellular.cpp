@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Particle.h"
+#include "location_modem_cellular.h"
+
+#if LOCATION_URC_READER
+#include "at_response.h"
+#endif // LOCATION_URC_READER
+
+bool LocationCellularModem::isOn() {
+    return Cellular.isOn();
+}
+
+LocationModemDevice LocationCellularModem::device() {
+    CellularDevice celldev = {};
+    cellular_device_info(&celldev, nullptr);
+    switch (celldev.dev) {
+        case 0:
+            // Modem not cached yet
+            return LocationModemDevice::Unknown;
+
+        case DEV_QUECTEL_BG95_M5:
+            return LocationModemDevice::Bg95M5;
+
+        default:
+            return LocationModemDevice::Other;
+    }
+}
+
+int LocationCellularModem::commandCallback(int type, const char* buf, int len, Command* context) {
+    auto response = LocationModemResponse::Text;
+    switch (type) {
+        case TYPE_OK:
+            response = LocationModemResponse::Ok;
+            break;
+
+        case TYPE_ERROR:
+            response = LocationModemResponse::Error;
+            break;
+
+        case TYPE_PLUS:
+            response = LocationModemResponse::Plus;
+            break;
+    }
+
+    context->callback(response, buf, len, context->param);
+    return WAIT;
+}
+
+int LocationCellularModem::command(LocationModemCallback callback, void* param, uint32_t timeoutMs, const char* command) {
+    int ret;
+    if (callback) {
+        Command context {callback, param};
+        ret = Cellular.command(commandCallback, &context, timeoutMs, "%s", command);
+    }
+    else {
+        ret = Cellular.command(timeoutMs, "%s", command);
+    }
+
+    return (RESP_OK == ret) ? 0 : -1;
+}
+
+#if LOCATION_URC_READER
+
+int LocationCellularModem::urcCallback(AtResponseReader* reader, const char* prefix, void* data) {
+    auto handler = static_cast<UrcHandler*>(data);
+    char line[MaxUrcLength];
+    auto len = reader->readLine(line, sizeof(line));
+    if (0 > len) {
+        return len;
+    }
+
+    handler->callback(prefix, line, len, handler->param);
+    return 0;
+}
+
+int LocationCellularModem::addUrcHandler(const char* prefix, LocationModemUrcCallback callback, void* param) {
+    for (auto& handler : _urcHandlers) {
+        if (handler.prefix) {
+            continue;
+        }
+        handler = {prefix, callback, param};
+        if (cellular_add_urc_handler(prefix, urcCallback, &handler)) {
+            handler = {};
+            return -1;
+        }
+        return 0;
+    }
+
+    return -1;
+}
+
+#else
+
+int LocationCellularModem::addUrcHandler(const char* /* prefix */, LocationModemUrcCallback /* callback */,
+                                         void* /* param */) {
+    return -1;
+}
+
+#endif // LOCATION_URC_READER
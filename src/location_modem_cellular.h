@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Particle.h"
+#include "location_modem.h"
+
+// URC lines are read with the AT parser of Device OS, whose header is internal to Device OS and not available to
+// application builds.  Without it addUrcHandler() fails, and push mode acquisitions poll instead.
+#ifndef LOCATION_URC_READER
+#if defined(__has_include)
+#if __has_include("at_response.h")
+#define LOCATION_URC_READER (1)
+#endif // __has_include
+#endif // __has_include
+#endif // LOCATION_URC_READER
+
+#ifndef LOCATION_URC_READER
+#define LOCATION_URC_READER (0)     /**< Set to 1 when at_response.h from Device OS is on the include path */
+#endif // LOCATION_URC_READER
+
+/**
+ * @brief LocationModem implementation using the Device OS cellular modem
+ *
+ */
+class LocationCellularModem : public LocationModem {
+public:
+    bool isOn() override;
+    LocationModemDevice device() override;
+    int command(LocationModemCallback callback, void* param, uint32_t timeoutMs, const char* command) override;
+    int addUrcHandler(const char* prefix, LocationModemUrcCallback callback, void* param) override;
+
+    using LocationModem::command;
+
+private:
+    struct Command {
+        LocationModemCallback callback;
+        void* param;
+    };
+
+    static int commandCallback(int type, const char* buf, int len, Command* context);
+
+#if LOCATION_URC_READER
+    struct UrcHandler {
+        const char* prefix;
+        LocationModemUrcCallback callback;
+        void* param;
+    };
+
+    static int urcCallback(AtResponseReader* reader, const char* prefix, void* data);
+
+    static constexpr size_t MaxUrcHandlers {4};
+    static constexpr size_t MaxUrcLength {96};
+
+    UrcHandler _urcHandlers[MaxUrcHandlers] {};
+#endif // LOCATION_URC_READER
+};
@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "location_modem_sim.h"
+
+namespace {
+
+const char* const SIM_SESSION_IS_ONGOING = "+CME ERROR: 504";
+const char* const SIM_SESSION_NOT_ACTIVE = "+CME ERROR: 505";
+const char* const SIM_NO_FIX = "+CME ERROR: 516";
+const char* const SIM_UNKNOWN_ERROR = "+CME ERROR: 549";
+const char* const SIM_XTRA_NO_TIME = "1980/01/06,00:00:00";   // Reported by the modem before time is injected
+constexpr size_t SIM_XTRA_TIME_LENGTH {19};
+
+bool matches(const char* command, size_t len, const char* expected) {
+    auto expectedLen = strlen(expected);
+    return (len == expectedLen) && (0 == strncmp(command, expected, len));
+}
+
+bool startsWith(const char* command, size_t len, const char* prefix) {
+    auto prefixLen = strlen(prefix);
+    return (len >= prefixLen) && (0 == strncmp(command, prefix, prefixLen));
+}
+
+} // anonymous namespace
+
+void LocationSimulatedModem::respond(LocationModemCallback callback, void* param, LocationModemResponse type,
+                                     const char* line) {
+    if (callback) {
+        // Frame the line the way the modem does so that callbacks see the same bytes as from the cellular modem
+        char framed[MaxLineLength];
+        auto len = snprintf(framed, sizeof(framed), "\r\n%s\r\n", line);
+        callback(type, framed, (len < (int)sizeof(framed)) ? len : (int)sizeof(framed) - 1, param);
+    }
+}
+
+int LocationSimulatedModem::error(LocationModemCallback callback, void* param, const char* line) {
+    respond(callback, param, LocationModemResponse::Error, line);
+    return -1;
+}
+
+const LocationSimulatedStep* LocationSimulatedModem::currentStep() const {
+    if (!_scenario) {
+        return nullptr;
+    }
+
+    auto elapsed = _clock() - _start;
+    if (_assisted) {
+        elapsed = elapsed * 100 / _xtraPercent;
+    }
+    const LocationSimulatedStep* current = nullptr;
+    for (size_t i = 0; i < _scenario->count; i++) {
+        if (_scenario->steps[i].atMs > elapsed) {
+            break;
+        }
+        current = &_scenario->steps[i];
+    }
+    return current;
+}
+
+bool LocationSimulatedModem::xtraValid() const {
+    return _xtraEnabled && _xtraDataLoaded && ('\0' != _xtraTime[0]) &&
+           ((_clock() - _xtraLoaded) < (uint64_t)_xtraMinutes * 60 * 1000);
+}
+
+int LocationSimulatedModem::executeXtra(const char* command, size_t len, LocationModemCallback callback, void* param) {
+    if (matches(command, len, "+QGPSXTRA=0") || matches(command, len, "+QGPSXTRA=1")) {
+        _xtraEnabled = ('1' == command[len - 1]);
+        return 0;
+    }
+
+    if (matches(command, len, "+QGPSXTRADATA?")) {
+        char line[64];
+        auto loaded = _xtraDataLoaded && xtraValid();
+        snprintf(line, sizeof(line), "+QGPSXTRADATA: %lu,\"%s\"", (loaded) ? (unsigned long)_xtraMinutes : 0ul,
+                 (loaded) ? _xtraStart : SIM_XTRA_NO_TIME);
+        respond(callback, param, LocationModemResponse::Plus, line);
+        return 0;
+    }
+
+    if (!_xtraEnabled) {
+        return error(callback, param, SIM_UNKNOWN_ERROR);
+    }
+
+    if (startsWith(command, len, "+QGPSXTRATIME=0,\"")) {
+        // Keep the quoted time, the force, UTC and uncertainty arguments are not modelled
+        auto time = command + strlen("+QGPSXTRATIME=0,\"");
+        if ((len < (size_t)(time - command) + SIM_XTRA_TIME_LENGTH + 1) || ('"' != time[SIM_XTRA_TIME_LENGTH])) {
+            return error(callback, param, SIM_UNKNOWN_ERROR);
+        }
+        memcpy(_xtraTime, time, SIM_XTRA_TIME_LENGTH);
+        _xtraTime[SIM_XTRA_TIME_LENGTH] = '\0';
+        return 0;
+    }
+
+    if (startsWith(command, len, "+QGPSXTRADATA=\"")) {
+        if (_active) {
+            return error(callback, param, SIM_SESSION_IS_ONGOING);
+        }
+        auto name = command + strlen("+QGPSXTRADATA=\"");
+        auto nameLen = len - (size_t)(name - command) - 1;
+        if (!_xtraFile || ('"' != command[len - 1]) || (strlen(_xtraFile) != nameLen) ||
+            strncmp(name, _xtraFile, nameLen)) {
+            return error(callback, param, SIM_UNKNOWN_ERROR);
+        }
+        _xtraDataLoaded = true;
+        _xtraLoaded = _clock();
+        strcpy(_xtraStart, ('\0' != _xtraTime[0]) ? _xtraTime : SIM_XTRA_NO_TIME);
+        return 0;
+    }
+
+    return error(callback, param, "ERROR");
+}
+
+int LocationSimulatedModem::execute(const char* command, size_t len, LocationModemCallback callback, void* param) {
+    _commands++;
+
+    if (matches(command, len, "+QGPS=1")) {
+        if (_active) {
+            return error(callback, param, SIM_SESSION_IS_ONGOING);
+        }
+        _active = true;
+        _start = _clock();
+        _nmeaSecond = 0;
+        _assisted = xtraValid();
+        return 0;
+    }
+
+    if (matches(command, len, "+QGPSEND")) {
+        if (!_active) {
+            return error(callback, param, SIM_SESSION_NOT_ACTIVE);
+        }
+        _active = false;
+        return 0;
+    }
+
+    if (startsWith(command, len, "+QGPSLOC=")) {
+        if (!_active) {
+            return error(callback, param, SIM_SESSION_NOT_ACTIVE);
+        }
+        auto step = currentStep();
+        if (!step || !step->qloc) {
+            return error(callback, param, SIM_NO_FIX);
+        }
+        respond(callback, param, LocationModemResponse::Plus, step->qloc);
+        return 0;
+    }
+
+    if (matches(command, len, R"(+QGPSCFG="estimation_error")")) {
+        if (!_active) {
+            return error(callback, param, SIM_SESSION_NOT_ACTIVE);
+        }
+        auto step = currentStep();
+        if (!step || !step->estimationError) {
+            return error(callback, param, SIM_NO_FIX);
+        }
+        respond(callback, param, LocationModemResponse::Plus, step->estimationError);
+        return 0;
+    }
+
+    if (matches(command, len, R"(+QGPSCFG="outport","uartnmea")") || matches(command, len, R"(+QGPSCFG="outport","none")")) {
+        _nmeaOutput = ('a' == command[len - 2]);
+        return 0;
+    }
+
+    if (matches(command, len, R"(+QGPSCFG="priority",0)") || matches(command, len, R"(+QGPSCFG="priority",1)")) {
+        _gnssPriority = ('0' == command[len - 1]);
+        return 0;
+    }
+
+    if (startsWith(command, len, "+QGPSCFG=")) {
+        return 0;
+    }
+
+    if (startsWith(command, len, "+QGPSXTRA")) {
+        return executeXtra(command, len, callback, param);
+    }
+
+    return error(callback, param, "ERROR");
+}
+
+int LocationSimulatedModem::command(LocationModemCallback callback, void* param, uint32_t /* timeoutMs */,
+                                    const char* command) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    if (!_on) {
+        return -1;  // Nothing answers, the command times out
+    }
+    if (0 != strncmp(command, "AT", 2)) {
+        return error(callback, param, "ERROR");
+    }
+
+    // Execute each part of a concatenated command line until one fails
+    auto part = command + 2;
+    for (;;) {
+        auto end = strchr(part, ';');
+        auto len = (end) ? (size_t)(end - part) : strlen(part);
+        if (execute(part, len, callback, param)) {
+            return -1;
+        }
+        if (!end) {
+            break;
+        }
+        part = end + 1;
+    }
+
+    respond(callback, param, LocationModemResponse::Ok, "OK");
+    return 0;
+}
+
+int LocationSimulatedModem::addUrcHandler(const char* prefix, LocationModemUrcCallback callback, void* param) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& handler : _urcHandlers) {
+        if (!handler.prefix) {
+            handler = {prefix, callback, param};
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+unsigned int LocationSimulatedModem::deliverUrcs() {
+    const char* nmea = nullptr;
+    UrcHandler handlers[MaxUrcHandlers];
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        if (!_on || !_active || !_nmeaUrcs || !_nmeaOutput) {
+            return 0;
+        }
+        auto second = (_clock() - _start) / 1000 + 1;
+        if (second == _nmeaSecond) {
+            return 0;
+        }
+        _nmeaSecond = second;
+        auto step = currentStep();
+        nmea = (step) ? step->nmea : nullptr;
+        memcpy(handlers, _urcHandlers, sizeof(handlers));
+    }
+
+    // Handlers run without the lock held, as they do on the thread of the cellular modem that reads URCs
+    unsigned int delivered = 0;
+    for (auto line = nmea; line && ('\0' != *line);) {
+        auto len = strcspn(line, "\r\n");
+        for (auto& handler : handlers) {
+            if (handler.prefix && startsWith(line, len, handler.prefix)) {
+                auto prefixLen = strlen(handler.prefix);
+                handler.callback(handler.prefix, line + prefixLen, (int)(len - prefixLen), handler.param);
+                delivered++;
+                break;
+            }
+        }
+        line += len;
+        line += strspn(line, "\r\n");
+    }
+    return delivered;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "location_modem.h"
+
+/**
+ * @brief Receiver output from a point in time of a simulated GNSS session
+ *
+ */
+struct LocationSimulatedStep {
+    uint32_t atMs;                  /**< Milliseconds after AT+QGPS=1 from which this step applies */
+    const char* qloc;               /**< +QGPSLOC response line, or null while there is no fix */
+    const char* estimationError;    /**< +QGPSCFG: "estimation_error" response line, or null */
+    const char* nmea {nullptr};     /**< NMEA sentences output once a second, separated by line endings, or null */
+};
+
+/**
+ * @brief Recorded or synthetic GNSS session, as steps in increasing time order
+ *
+ */
+struct LocationSimulatedScenario {
+    const char* name;                       /**< Scenario name used in reports */
+    const LocationSimulatedStep* steps;     /**< Steps of the session */
+    size_t count;                           /**< Number of steps */
+};
+
+/**
+ * @brief Simulated BG95-M5 answering GNSS AT commands from a scenario
+ *
+ * AT+QGPS=1 starts the scenario clock and each AT+QGPSLOC or estimation error query is answered from the latest step
+ * that applies, or with +CME ERROR: 516 before the first one.  Commands sent without a session answer +CME ERROR: 505
+ * as the modem does, and errors abort the remainder of a concatenated command line.  The RF priority set with
+ * AT+QGPSCFG="priority" is recorded, other AT+QGPSCFG settings are accepted and ignored.
+ *
+ * Like the BG95, the simulator sends nothing to the AT port after AT+QGPSCFG="outport","uartnmea" by default, so
+ * LocationAcquisitionMode::Push sessions fall back to polling.  With nmeaUrcs() enabled the NMEA sentences of the
+ * current step are delivered to the handlers added with addUrcHandler() instead, once per second of session time, by
+ * deliverUrcs().  That has to be called periodically from a thread other than the one sending commands, since URCs
+ * arrive asynchronously from a real modem.
+ *
+ * XTRA assistance is modelled by AT+QGPSXTRA, AT+QGPSXTRATIME, AT+QGPSXTRADATA and the AT+QGPSXTRADATA? query.  A
+ * session started with XTRA enabled, time injected and unexpired data loaded from the file given to assistanceFile()
+ * plays its scenario faster, so that the first fix arrives after the given percentage of the scenario time.
+ *
+ * The simulator has no platform dependencies, time is read from the clock given at construction.  Commands and
+ * deliverUrcs() are serialized by a mutex of the C++ standard library.
+ *
+ */
+class LocationSimulatedModem : public LocationModem {
+public:
+    typedef uint64_t (*Clock)();    /**< Monotonic time in milliseconds */
+
+    /**
+     * @brief Construct a powered on simulated modem without a scenario
+     *
+     * @param clock Source of monotonic time in milliseconds
+     */
+    explicit LocationSimulatedModem(Clock clock) : _clock(clock) {
+    }
+
+    /**
+     * @brief Set the scenario played by the next session
+     *
+     * @param scenario Scenario, which must remain valid while in use
+     */
+    void scenario(const LocationSimulatedScenario& scenario) {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _scenario = &scenario;
+    }
+
+    /**
+     * @brief Make an XTRA data file available in the simulated modem file system
+     *
+     * @param name Filename accepted by AT+QGPSXTRADATA, which must remain valid while in use
+     * @param ttffPercent Scenario time, in percent, taken by assisted sessions
+     * @param validMinutes Validity of the data once loaded
+     */
+    void assistanceFile(const char* name, unsigned int ttffPercent = 30, uint32_t validMinutes = 7 * 24 * 60) {
+        _xtraFile = name;
+        _xtraPercent = (ttffPercent) ? ttffPercent : 1;
+        _xtraMinutes = validMinutes;
+    }
+
+    /**
+     * @brief Indicate whether the current or last session was assisted
+     *
+     * @return true Session started with XTRA enabled, time injected and valid data loaded
+     * @return false Session was unassisted
+     */
+    bool assisted() const {
+        return _assisted;
+    }
+
+    /**
+     * @brief Set whether NMEA output enabled with AT+QGPSCFG="outport","uartnmea" is delivered as URCs
+     *
+     * @param enable Deliver NMEA sentences of the scenario to URC handlers, which the BG95 does not do
+     */
+    void nmeaUrcs(bool enable) {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _nmeaUrcs = enable;
+    }
+
+    /**
+     * @brief Deliver the NMEA output due since the last call as URCs
+     *
+     * Sentences of the current step are delivered once per second of session time while a session is running, NMEA
+     * output is enabled on the AT port and nmeaUrcs() is set.  Each sentence goes to the first handler whose prefix
+     * it starts with, and sentences without a matching handler are discarded.
+     *
+     * @return unsigned int Number of sentences delivered
+     */
+    unsigned int deliverUrcs();
+
+    /**
+     * @brief Simulate the modem being powered on or off, which ends any session
+     *
+     * @param on Modem is on
+     */
+    void power(bool on) {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _on = on;
+        if (!on) {
+            _active = false;
+            _gnssPriority = false;
+        }
+    }
+
+    /**
+     * @brief Indicate whether a GNSS session is running
+     *
+     * @return true AT+QGPS=1 was received without a following AT+QGPSEND
+     * @return false No session
+     */
+    bool sessionActive() const {
+        return _active;
+    }
+
+    /**
+     * @brief Get the number of commands received, counting each part of a concatenated command line
+     *
+     * @return unsigned int Number of commands
+     */
+    unsigned int commands() const {
+        return _commands;
+    }
+
+    /**
+     * @brief Indicate whether GNSS was last given RF priority with AT+QGPSCFG="priority"
+     *
+     * @return true GNSS has priority
+     * @return false WWAN has priority, as after power on
+     */
+    bool gnssPriority() const {
+        return _gnssPriority;
+    }
+
+    bool isOn() override {
+        return _on;
+    }
+
+    LocationModemDevice device() override {
+        return (_on) ? LocationModemDevice::Bg95M5 : LocationModemDevice::Unknown;
+    }
+
+    int command(LocationModemCallback callback, void* param, uint32_t timeoutMs, const char* command) override;
+
+    int addUrcHandler(const char* prefix, LocationModemUrcCallback callback, void* param) override;
+
+    using LocationModem::command;
+
+private:
+    struct UrcHandler {
+        const char* prefix;
+        LocationModemUrcCallback callback;
+        void* param;
+    };
+
+    int execute(const char* command, size_t len, LocationModemCallback callback, void* param);
+    const LocationSimulatedStep* currentStep() const;
+    static void respond(LocationModemCallback callback, void* param, LocationModemResponse type, const char* line);
+    static int error(LocationModemCallback callback, void* param, const char* line);
+    int executeXtra(const char* command, size_t len, LocationModemCallback callback, void* param);
+    bool xtraValid() const;
+
+    static constexpr size_t MaxLineLength {256};
+    static constexpr size_t MaxUrcHandlers {4};
+
+    Clock _clock;
+    const LocationSimulatedScenario* _scenario {nullptr};
+    uint64_t _start {};
+    unsigned int _commands {};
+    bool _on {true};
+    bool _active {false};
+    bool _gnssPriority {false};
+    std::mutex _mutex;
+
+    // NMEA output
+    UrcHandler _urcHandlers[MaxUrcHandlers] {};
+    bool _nmeaUrcs {false};
+    bool _nmeaOutput {false};       // AT+QGPSCFG="outport","uartnmea" in effect
+    uint64_t _nmeaSecond {};        // Session second after the last delivery, 0 before the first
+
+    // XTRA state
+    const char* _xtraFile {nullptr};
+    unsigned int _xtraPercent {100};
+    uint32_t _xtraMinutes {};
+    char _xtraTime[20] {};          // Last injected time as YYYY/MM/DD,hh:mm:ss
+    char _xtraStart[20] {};         // Injected time when the data was loaded
+    uint64_t _xtraLoaded {};
+    bool _xtraEnabled {false};
+    bool _xtraDataLoaded {false};
+    bool _assisted {false};
+};
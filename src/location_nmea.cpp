@@ -0,0 +1,531 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+
+#include "location_nmea.h"
+#include "location_time.h"
+
+namespace {
+
+constexpr uint32_t NMEA_OVERFLOW_LIMIT {429496729u}; // UINT32_MAX / 10
+constexpr float KNOTS_E3_TO_MPS {0.514444f / 1000.0f};
+constexpr float KMPH_E3_TO_MPS {1.0f / 3600.0f};
+
+} // anonymous namespace
+
+void LocationNmeaParser::reset() {
+    _state = State::Idle;
+    _checksum = 0;
+    _expected = 0;
+    _length = 0;
+    _field = 0;
+    _sentence = LOCATION_NMEA_NONE;
+    _addressLength = 0;
+    memset(_address, 0, sizeof(_address));
+    _whole = 0;
+    _fraction = 0;
+    _fractionDigits = 0;
+    _digits = false;
+    _dot = false;
+    _negative = false;
+    _char = '\0';
+    _staging = {};
+    _point = {};
+    _satellites = {};
+    memset(_inView, 0, sizeof(_inView));
+    memset(_usedPrn, 0, sizeof(_usedPrn));
+    _usedCount = 0;
+    _date = 0;
+    _newEpoch = true;
+    _updated = LOCATION_NMEA_NONE;
+    _errors = 0;
+}
+
+int LocationNmeaParser::hexValue(char c) {
+    if (isDigit(c)) {
+        return c - '0';
+    }
+    if (('A' <= c) && ('F' >= c)) {
+        return c - 'A' + 10;
+    }
+    if (('a' <= c) && ('f' >= c)) {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+LocationGnssSystem LocationNmeaParser::systemFromTalker(const char* talker) {
+    if ('G' == talker[0]) {
+        switch (talker[1]) {
+            case 'P': return LocationGnssSystem::Gps;
+            case 'L': return LocationGnssSystem::Glonass;
+            case 'A': return LocationGnssSystem::Galileo;
+            case 'B': return LocationGnssSystem::Beidou;
+            case 'Q': return LocationGnssSystem::Qzss;
+        }
+    }
+    else if (('B' == talker[0]) && ('D' == talker[1])) {
+        return LocationGnssSystem::Beidou;
+    }
+    else if (('Q' == talker[0]) && ('Z' == talker[1])) {
+        return LocationGnssSystem::Qzss;
+    }
+    return LocationGnssSystem::Unknown;
+}
+
+int LocationNmeaParser::feed(const char* data, size_t len) {
+    int completed = LOCATION_NMEA_NONE;
+    for (size_t i = 0; i < len; i++) {
+        completed |= feed(data[i]);
+    }
+    return completed;
+}
+
+LocationNmeaSentence LocationNmeaParser::feed(char c) {
+    if ('$' == c) {
+        if (State::Idle != _state) {
+            _errors++;  // Previous sentence was truncated
+        }
+        startSentence();
+        return LOCATION_NMEA_NONE;
+    }
+
+    switch (_state) {
+        case State::Idle:
+            break;
+
+        case State::Field:
+            if ('*' == c) {
+                endField();
+                _state = State::Checksum1;
+                break;
+            }
+            if (('\r' == c) || ('\n' == c) || (MaxSentenceLength < ++_length)) {
+                _errors++;  // Missing checksum or runaway sentence
+                _state = State::Idle;
+                break;
+            }
+            _checksum ^= (uint8_t)c;
+            if (',' == c) {
+                endField();
+                _field++;
+                _whole = 0;
+                _fraction = 0;
+                _fractionDigits = 0;
+                _digits = false;
+                _dot = false;
+                _negative = false;
+                _char = '\0';
+            }
+            else {
+                accumulate(c);
+            }
+            break;
+
+        case State::Checksum1: {
+            auto value = hexValue(c);
+            if (0 > value) {
+                _errors++;
+                _state = State::Idle;
+                break;
+            }
+            _expected = (uint8_t)(value << 4);
+            _state = State::Checksum2;
+            break;
+        }
+
+        case State::Checksum2: {
+            auto value = hexValue(c);
+            _state = State::Idle;
+            if ((0 > value) || ((_expected | value) != _checksum)) {
+                _errors++;
+                break;
+            }
+            return commit();
+        }
+    }
+
+    return LOCATION_NMEA_NONE;
+}
+
+void LocationNmeaParser::startSentence() {
+    _state = State::Field;
+    _checksum = 0;
+    _length = 0;
+    _field = 0;
+    _sentence = LOCATION_NMEA_NONE;
+    _addressLength = 0;
+    _whole = 0;
+    _fraction = 0;
+    _fractionDigits = 0;
+    _digits = false;
+    _dot = false;
+    _negative = false;
+    _char = '\0';
+    _staging = {};
+}
+
+void LocationNmeaParser::accumulate(char c) {
+    if (0 == _field) {
+        if (_addressLength < sizeof(_address) - 1) {
+            _address[_addressLength] = c;
+        }
+        _addressLength++;
+        return;
+    }
+
+    if (isDigit(c)) {
+        _digits = true;
+        if (_dot) {
+            if (MaxFraction > _fractionDigits) {
+                _fraction = _fraction * 10 + (c - '0');
+                _fractionDigits++;
+            }
+        }
+        else if (NMEA_OVERFLOW_LIMIT > _whole) {
+            _whole = _whole * 10 + (c - '0');
+        }
+    }
+    else if ('.' == c) {
+        _dot = true;
+    }
+    else if ('-' == c) {
+        _negative = true;
+    }
+    else {
+        _char = c;
+    }
+}
+
+int32_t LocationNmeaParser::fieldFixed(int decimals) const {
+    auto fraction = _fraction;
+    auto digits = _fractionDigits;
+    int32_t value = (int32_t)_whole;
+
+    for (; digits > decimals; digits--) {
+        fraction /= 10;
+    }
+    for (; digits < decimals; digits++) {
+        fraction *= 10;
+    }
+    for (int i = 0; i < decimals; i++) {
+        value *= 10;
+    }
+    value += (int32_t)fraction;
+
+    return (_negative) ? -value : value;
+}
+
+int32_t LocationNmeaParser::fieldCoordinate() const {
+    // NMEA coordinates are (d)ddmm.mmmm, convert to 1e-7 degrees without floating point
+    auto degrees = _whole / 100;
+    auto minutes = _whole % 100;
+    auto fraction = _fraction;
+    for (auto digits = _fractionDigits; digits < MaxFraction; digits++) {
+        fraction *= 10;
+    }
+    auto minutesE7 = minutes * 10000000u + fraction;
+
+    return (int32_t)(degrees * 10000000u + (minutesE7 + 30) / 60);
+}
+
+void LocationNmeaParser::endField() {
+    if (0 == _field) {
+        endAddress();
+        return;
+    }
+
+    if ((LOCATION_NMEA_NONE == _sentence) || (!_digits && ('\0' == _char))) {
+        return;
+    }
+
+    if (32 > _field) {
+        _staging.seen |= (1u << _field);
+    }
+
+    switch (_sentence) {
+        case LOCATION_NMEA_GGA: endGga(); break;
+        case LOCATION_NMEA_RMC: endRmc(); break;
+        case LOCATION_NMEA_GSA: endGsa(); break;
+        case LOCATION_NMEA_GSV: endGsv(); break;
+        case LOCATION_NMEA_VTG: endVtg(); break;
+        default: break;
+    }
+}
+
+void LocationNmeaParser::endAddress() {
+    // Expect a two character talker followed by a three character sentence formatter
+    if (5 != _addressLength) {
+        return;
+    }
+
+    auto formatter = &_address[2];
+    if (0 == strcmp(formatter, "GGA")) {
+        _sentence = LOCATION_NMEA_GGA;
+    }
+    else if (0 == strcmp(formatter, "RMC")) {
+        _sentence = LOCATION_NMEA_RMC;
+    }
+    else if (0 == strcmp(formatter, "GSA")) {
+        _sentence = LOCATION_NMEA_GSA;
+    }
+    else if (0 == strcmp(formatter, "GSV")) {
+        _sentence = LOCATION_NMEA_GSV;
+    }
+    else if (0 == strcmp(formatter, "VTG")) {
+        _sentence = LOCATION_NMEA_VTG;
+    }
+}
+
+void LocationNmeaParser::endGga() {
+    // $--GGA,hhmmss.ss,ddmm.mm,a,dddmm.mm,a,x,xx,x.x,x.x,M,x.x,M,x.x,xxxx
+    switch (_field) {
+        case 1: _staging.time = _whole; break;
+        case 2: _staging.latitude = fieldCoordinate(); break;
+        case 3: if ('S' == _char) _staging.latitude = -_staging.latitude; break;
+        case 4: _staging.longitude = fieldCoordinate(); break;
+        case 5: if ('W' == _char) _staging.longitude = -_staging.longitude; break;
+        case 6: _staging.quality = (uint8_t)_whole; break;
+        case 7: _staging.nsat = (uint8_t)_whole; break;
+        case 8: _staging.hdopE2 = fieldFixed(2); break;
+        case 9: _staging.altitude = fieldFixed(3); break;
+    }
+}
+
+void LocationNmeaParser::endRmc() {
+    // $--RMC,hhmmss.ss,A,ddmm.mm,a,dddmm.mm,a,x.x,x.x,ddmmyy,x.x,a,a
+    switch (_field) {
+        case 1: _staging.time = _whole; break;
+        case 2: _staging.valid = ('A' == _char); break;
+        case 3: _staging.latitude = fieldCoordinate(); break;
+        case 4: if ('S' == _char) _staging.latitude = -_staging.latitude; break;
+        case 5: _staging.longitude = fieldCoordinate(); break;
+        case 6: if ('W' == _char) _staging.longitude = -_staging.longitude; break;
+        case 7: _staging.speedE3 = fieldFixed(3); break;
+        case 8: _staging.courseE2 = fieldFixed(2); break;
+        case 9: _staging.date = _whole; break;
+    }
+}
+
+void LocationNmeaParser::endGsa() {
+    // $--GSA,a,x,xx,xx,xx,xx,xx,xx,xx,xx,xx,xx,xx,xx,x.x,x.x,x.x
+    if (2 == _field) {
+        _staging.quality = (uint8_t)_whole;
+    }
+    else if ((3 <= _field) && (14 >= _field)) {
+        if (MaxGsaPrns > _staging.gsaCount) {
+            _staging.gsaPrn[_staging.gsaCount++] = (uint8_t)_whole;
+        }
+    }
+    else if (16 == _field) {
+        _staging.hdopE2 = fieldFixed(2);
+    }
+    else if (17 == _field) {
+        _staging.vdopE2 = fieldFixed(2);
+    }
+}
+
+void LocationNmeaParser::endGsv() {
+    // $--GSV,x,x,x,xx,xx,xxx,xx,...
+    switch (_field) {
+        case 1: return;  // Total number of messages is implied by the message number
+        case 2: _staging.gsvNumber = (uint8_t)_whole; return;
+        case 3: _staging.gsvInView = (uint8_t)_whole; return;
+    }
+
+    auto index = (_field - 4) / 4;
+    if (MaxGsvSatellites <= index) {
+        return;
+    }
+    auto& satellite = _staging.gsv[index];
+    switch ((_field - 4) % 4) {
+        case 0: satellite.prn = (uint8_t)_whole; break;
+        case 1: satellite.elevation = (int8_t)fieldFixed(0); break;
+        case 2: satellite.azimuth = (uint16_t)_whole; break;
+        case 3: satellite.snr = (uint8_t)_whole; break;
+    }
+}
+
+void LocationNmeaParser::endVtg() {
+    // $--VTG,x.x,T,x.x,M,x.x,N,x.x,K,a
+    switch (_field) {
+        case 1: _staging.courseE2 = fieldFixed(2); break;
+        case 7: _staging.speedE3 = fieldFixed(3); break;
+    }
+}
+
+void LocationNmeaParser::setTime(uint32_t time) {
+    if (0 == _date) {
+        return;  // Date is only known after an RMC sentence
+    }
+    _point.epochTime = LocationTime::epochFromUtc(_date % 100 + 2000, (_date / 100) % 100, _date / 10000,
+                                                  time / 10000, (time / 100) % 100, time % 100);
+}
+
+LocationNmeaSentence LocationNmeaParser::commit() {
+    switch (_sentence) {
+        case LOCATION_NMEA_GGA: commitGga(); break;
+        case LOCATION_NMEA_RMC: commitRmc(); break;
+        case LOCATION_NMEA_GSA: commitGsa(); break;
+        case LOCATION_NMEA_GSV: commitGsv(); break;
+        case LOCATION_NMEA_VTG: commitVtg(); break;
+        default: return LOCATION_NMEA_NONE;
+    }
+
+    _updated |= _sentence;
+    return _sentence;
+}
+
+void LocationNmeaParser::commitGga() {
+    auto seen = _staging.seen;
+    _newEpoch = true;
+
+    if (!(seen & (1u << 6)) || (0 == _staging.quality)) {
+        _point.fix = 0;
+        return;
+    }
+
+    if (0 == _point.fix) {
+        _point.fix = 2;  // Assume 2D until a GSA sentence reports the fix type
+    }
+    if (seen & (1u << 1)) {
+        setTime(_staging.time);
+    }
+    if ((seen & (1u << 2)) && (seen & (1u << 4))) {
+        _point.latitude = LocationCoordinateTraits::fromE7(_staging.latitude);
+        _point.longitude = LocationCoordinateTraits::fromE7(_staging.longitude);
+    }
+    if (seen & (1u << 7)) {
+        _point.satsInUse = _staging.nsat;
+    }
+    if (seen & (1u << 8)) {
+        _point.horizontalDop = (float)_staging.hdopE2 * 1.0e-2f;
+    }
+    if (seen & (1u << 9)) {
+        _point.altitude = (float)_staging.altitude * 1.0e-3f;
+    }
+}
+
+void LocationNmeaParser::commitRmc() {
+    auto seen = _staging.seen;
+    _newEpoch = true;
+
+    if (seen & (1u << 9)) {
+        _date = _staging.date;
+    }
+    if (!_staging.valid) {
+        _point.fix = 0;
+        return;
+    }
+
+    if (0 == _point.fix) {
+        _point.fix = 2;
+    }
+    if (seen & (1u << 1)) {
+        setTime(_staging.time);
+    }
+    if ((seen & (1u << 3)) && (seen & (1u << 5))) {
+        _point.latitude = LocationCoordinateTraits::fromE7(_staging.latitude);
+        _point.longitude = LocationCoordinateTraits::fromE7(_staging.longitude);
+    }
+    if (seen & (1u << 7)) {
+        _point.speed = (float)_staging.speedE3 * KNOTS_E3_TO_MPS;
+    }
+    if (seen & (1u << 8)) {
+        _point.heading = (float)_staging.courseE2 * 1.0e-2f;
+    }
+}
+
+void LocationNmeaParser::commitGsa() {
+    auto seen = _staging.seen;
+
+    // Fix types follow AT+QGPSLOC, 2 for 2D and 3 for 3D
+    if (seen & (1u << 2)) {
+        _point.fix = (2 <= _staging.quality) ? _staging.quality : 0;
+    }
+    if (seen & (1u << 16)) {
+        _point.horizontalDop = (float)_staging.hdopE2 * 1.0e-2f;
+    }
+    if (seen & (1u << 17)) {
+        _point.verticalDop = (float)_staging.vdopE2 * 1.0e-2f;
+    }
+
+    // Several GSA sentences may follow a fix when multiple systems are in use, only clear usage on the first one
+    if (_newEpoch) {
+        _usedCount = 0;
+        _newEpoch = false;
+    }
+    for (unsigned int i = 0; (i < _staging.gsaCount) && (LocationMaxSatellites > _usedCount); i++) {
+        _usedPrn[_usedCount++] = _staging.gsaPrn[i];
+    }
+    for (unsigned int i = 0; i < _satellites.count; i++) {
+        _satellites.satellite[i].used = isUsed(_satellites.satellite[i].prn);
+    }
+}
+
+bool LocationNmeaParser::isUsed(uint8_t prn) const {
+    for (unsigned int i = 0; i < _usedCount; i++) {
+        if (prn == _usedPrn[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LocationNmeaParser::commitGsv() {
+    auto system = systemFromTalker(_address);
+
+    // The first message of a group replaces every satellite of the same system
+    if (1 == _staging.gsvNumber) {
+        unsigned int kept = 0;
+        for (unsigned int i = 0; i < _satellites.count; i++) {
+            if (system != _satellites.satellite[i].system) {
+                _satellites.satellite[kept++] = _satellites.satellite[i];
+            }
+        }
+        _satellites.count = kept;
+    }
+
+    _inView[(size_t)system] = _staging.gsvInView;
+    _satellites.inView = 0;
+    for (auto count : _inView) {
+        _satellites.inView += count;
+    }
+
+    // Satellites take four fields each after the three header fields, NMEA 4.10 may append a signal identifier
+    auto satellites = (3 < _field) ? (_field - 3) / 4 : 0;
+    for (unsigned int i = 0; (i < satellites) && (i < MaxGsvSatellites); i++) {
+        auto& satellite = _staging.gsv[i];
+        if ((0 == satellite.prn) || (LocationMaxSatellites <= _satellites.count)) {
+            continue;
+        }
+        satellite.system = system;
+        satellite.used = isUsed(satellite.prn);
+        _satellites.satellite[_satellites.count++] = satellite;
+    }
+}
+
+void LocationNmeaParser::commitVtg() {
+    auto seen = _staging.seen;
+
+    if (seen & (1u << 1)) {
+        _point.heading = (float)_staging.courseE2 * 1.0e-2f;
+    }
+    if (seen & (1u << 7)) {
+        _point.speed = (float)_staging.speedE3 * KMPH_E3_TO_MPS;
+    }
+}
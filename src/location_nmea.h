@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "location_point.h"
+
+constexpr size_t LocationMaxSatellites {32};   /**< Maximum number of satellites tracked from GSV sentences */
+
+/**
+ * @brief NMEA sentence types understood by LocationNmeaParser
+ *
+ */
+enum LocationNmeaSentence {
+    LOCATION_NMEA_NONE              = 0,
+    LOCATION_NMEA_GGA               = (1 << 0),
+    LOCATION_NMEA_RMC               = (1 << 1),
+    LOCATION_NMEA_GSA               = (1 << 2),
+    LOCATION_NMEA_GSV               = (1 << 3),
+    LOCATION_NMEA_VTG               = (1 << 4),
+};
+
+/**
+ * @brief GNSS system of a satellite, taken from the NMEA talker identifier
+ *
+ */
+enum class LocationGnssSystem : uint8_t {
+    Unknown,
+    Gps,
+    Glonass,
+    Galileo,
+    Beidou,
+    Qzss,
+};
+
+/**
+ * @brief Satellite in view as reported by GSV and GSA sentences.
+ *
+ */
+struct LocationSatellite {
+    LocationGnssSystem system;      /**< GNSS system of the satellite */
+    uint8_t prn;                    /**< Satellite PRN number */
+    int8_t elevation;               /**< Elevation in degrees, 0 to 90 */
+    uint16_t azimuth;               /**< Azimuth in degrees, 0 to 359 */
+    uint8_t snr;                    /**< Signal to noise ratio in dB-Hz, 0 if not tracking */
+    bool used;                      /**< Satellite is used in the current solution */
+};
+
+/**
+ * @brief Satellites in view.
+ *
+ */
+struct LocationSatellites {
+    unsigned int inView;                                /**< Satellites in view summed over GNSS systems */
+    unsigned int count;                                 /**< Number of valid entries in satellite */
+    LocationSatellite satellite[LocationMaxSatellites]; /**< Satellite details */
+};
+
+/**
+ * @brief Incremental NMEA 0183 parser
+ *
+ * Bytes are consumed one at a time and each field is decoded as it arrives, so sentences are never buffered.  Decoded
+ * fields are staged and only applied to the location point and satellite data once the sentence checksum validates.
+ *
+ */
+class LocationNmeaParser {
+public:
+    LocationNmeaParser() {
+        reset();
+    }
+
+    /**
+     * @brief Clear parser state, the location point and satellite data
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Consume one byte of NMEA output
+     *
+     * @param c Byte to consume
+     * @return LocationNmeaSentence Type of sentence completed and validated by this byte, otherwise LOCATION_NMEA_NONE
+     */
+    LocationNmeaSentence feed(char c);
+
+    /**
+     * @brief Consume a block of NMEA output
+     *
+     * @param data Bytes to consume
+     * @param len Number of bytes
+     * @return int Bitmap of LocationNmeaSentence types completed and validated by this block
+     */
+    int feed(const char* data, size_t len);
+
+    /**
+     * @brief Get the location point assembled from validated sentences
+     *
+     * @return const LocationPoint&
+     */
+    const LocationPoint& point() const {
+        return _point;
+    }
+
+    /**
+     * @brief Get the satellites assembled from validated sentences
+     *
+     * @return const LocationSatellites&
+     */
+    const LocationSatellites& satellites() const {
+        return _satellites;
+    }
+
+    /**
+     * @brief Get the bitmap of LocationNmeaSentence types applied since the last call to clearUpdated()
+     *
+     * @return int Bitmap of LocationNmeaSentence types
+     */
+    int updated() const {
+        return _updated;
+    }
+
+    /**
+     * @brief Clear the bitmap of applied sentence types
+     *
+     */
+    void clearUpdated() {
+        _updated = LOCATION_NMEA_NONE;
+    }
+
+    /**
+     * @brief Get the number of sentences discarded because of checksum or framing errors
+     *
+     * @return unsigned int Number of discarded sentences
+     */
+    unsigned int errors() const {
+        return _errors;
+    }
+
+private:
+    enum class State {
+        Idle,                       /**< Waiting for '$' */
+        Field,                      /**< Receiving comma separated fields */
+        Checksum1,                  /**< Waiting for first checksum digit */
+        Checksum2,                  /**< Waiting for second checksum digit */
+    };
+
+    // Number of characters in a sentence between '$' and '*' allowed by NMEA 0183 plus some margin
+    static constexpr unsigned int MaxSentenceLength {96};
+    static constexpr int MaxFraction {7};
+    static constexpr size_t MaxGsvSatellites {4};
+    static constexpr size_t MaxGsaPrns {12};
+
+    // Decoded fields of the sentence being received
+    struct Staging {
+        uint32_t seen;              // Bitmap of field indexes that held data
+        uint32_t time;              // hhmmss
+        uint32_t date;              // ddmmyy
+        int32_t latitude;           // 1e-7 degrees
+        int32_t longitude;          // 1e-7 degrees
+        int32_t altitude;           // Millimeters
+        int32_t speedE3;            // Speed in thousandths of knots (RMC) or km/h (VTG)
+        int32_t courseE2;           // Course in hundredths of degrees
+        int32_t hdopE2;
+        int32_t vdopE2;
+        uint8_t quality;            // GGA fix quality, GSA fix type
+        uint8_t nsat;
+        bool valid;                 // RMC status
+        uint8_t gsvNumber;
+        uint8_t gsvInView;
+        LocationSatellite gsv[MaxGsvSatellites];
+        uint8_t gsaCount;
+        uint8_t gsaPrn[MaxGsaPrns];
+    };
+
+    static bool isDigit(char c) {
+        return ('0' <= c) && ('9' >= c);
+    }
+
+    static int hexValue(char c);
+    static LocationGnssSystem systemFromTalker(const char* talker);
+
+    void startSentence();
+    void accumulate(char c);
+    void endField();
+    void endAddress();
+    void endGga();
+    void endRmc();
+    void endGsa();
+    void endGsv();
+    void endVtg();
+    LocationNmeaSentence commit();
+    void commitGga();
+    void commitRmc();
+    void commitGsa();
+    void commitGsv();
+    void commitVtg();
+    void setTime(uint32_t time);
+    bool isUsed(uint8_t prn) const;
+    int32_t fieldFixed(int decimals) const;
+    int32_t fieldCoordinate() const;
+
+    State _state;
+    uint8_t _checksum;
+    uint8_t _expected;
+    unsigned int _length;
+    unsigned int _field;
+    LocationNmeaSentence _sentence;
+    char _address[6];
+    unsigned int _addressLength;
+
+    // Current field accumulator
+    uint32_t _whole;
+    uint32_t _fraction;
+    int _fractionDigits;
+    bool _digits;
+    bool _dot;
+    bool _negative;
+    char _char;
+
+    Staging _staging;
+    LocationPoint _point;
+    LocationSatellites _satellites;
+    uint8_t _inView[(size_t)LocationGnssSystem::Qzss + 1];
+    uint8_t _usedPrn[LocationMaxSatellites];
+    unsigned int _usedCount;
+    uint32_t _date;
+    bool _newEpoch;
+    int _updated;
+    unsigned int _errors;
+};
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "location_point.h"
+
 /**
  * @brief GNSS constellation types
  *
@@ -28,10 +30,48 @@ enum LocationConstellation {
     LOCATION_CONST_GPS_QZSS         = (1 << 3),
 };
 
+/**
+ * @brief GNSS acquisition modes
+ *
+ */
+enum class LocationAcquisitionMode {
+    Polled,                 /**< Poll the modem for position with AT+QGPSLOC */
+    Push,                   /**< Modem pushes NMEA sentences as URCs, falls back to polling on the BG95 */
+};
+
+/**
+ * @brief Encodings of published location events
+ *
+ */
+enum class LocationPublishEncoding {
+    Json,                   /**< JSON object published as the "loc" event */
+    Packed,                 /**< Base64 wrapped LocationEncoder record published as the "locb" event */
+};
+
+/**
+ * @brief Session parameters applied according to the start type of each session
+ *
+ */
+struct LocationStartPolicy {
+    unsigned int settlingCount;     /**< Consecutive fixes required to settle, 0 for the library default of 2 */
+    unsigned int pollIntervalMs;    /**< Interval between polls while fixes arrive, 0 for pollIntervalMinimum() */
+    unsigned int maximumFixSeconds; /**< Time allowed for a fix, 0 for maximumFixTime() which also caps it */
+};
+
 constexpr LocationConstellation LocationConstellationDefault {LOCATION_CONST_GPS_GLONASS};
 constexpr int LocationHdopDefault {100};
 constexpr float LocationHaccDefault {50.0}; // Meters
 constexpr unsigned int LocationFixTimeDefault {90}; // Seconds
+constexpr unsigned int LocationPollIntervalDefault {1000}; // Milliseconds
+constexpr float LocationPollBackoffDefault {2.0};
+constexpr unsigned int LocationReplayIntervalDefault {1000}; // Milliseconds
+constexpr unsigned int LocationAssistanceMarginDefault {12 * 60}; // Minutes
+constexpr unsigned int LocationRfGapDefault {5000}; // Milliseconds
+constexpr unsigned int LocationRfDeferDefault {30000}; // Milliseconds
+constexpr unsigned int LocationDutyMinimumDefault {30}; // Seconds
+constexpr unsigned int LocationDutyMinimumFloor {1}; // Seconds
+constexpr unsigned int LocationDutyMaximumDefault {60 * 60}; // Seconds
+constexpr unsigned int LocationDutyDistanceDefault {100}; // Meters
 
 /**
  * @brief LocationConfiguration class to configure Location class options
@@ -48,7 +88,26 @@ public:
         _antennaPin(PIN_INVALID),
         _hdop(LocationHdopDefault),
         _hacc(LocationHaccDefault),
-        _maxFixSeconds(LocationFixTimeDefault) {
+        _maxFixSeconds(LocationFixTimeDefault),
+        _acquisitionMode(LocationAcquisitionMode::Polled),
+        _pollMinimum(LocationPollIntervalDefault),
+        _pollMaximum(LocationPollIntervalDefault),
+        _pollBackoff(LocationPollBackoffDefault),
+        _publishEncoding(LocationPublishEncoding::Json),
+        _batchCount(0),
+        _batchAge(0),
+        _storeSlots(0),
+        _replayInterval(LocationReplayIntervalDefault),
+        _assistance(false),
+        _assistanceMargin(LocationAssistanceMarginDefault),
+        _reference(false),
+        _startPolicy{{}, {}, {}, {}},
+        _rfWindow(0),
+        _rfGap(LocationRfGapDefault),
+        _rfDefer(LocationRfDeferDefault),
+        _dutyMinimum(LocationDutyMinimumDefault),
+        _dutyMaximum(LocationDutyMaximumDefault),
+        _dutyDistance(LocationDutyDistanceDefault) {
     }
 
     /**
@@ -161,6 +220,353 @@ public:
         return _maxFixSeconds;
     }
 
+    /**
+     * @brief Set the acquisition mode
+     *
+     * Push mode falls back to polling for good once a session sees no NMEA output, which is always the case with
+     * the BG95 as it sends "uartnmea" output to its debug UART.
+     *
+     * @param mode Polled for AT+QGPSLOC polling, Push to react to NMEA sentences sent by the modem
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& acquisitionMode(LocationAcquisitionMode mode) {
+        _acquisitionMode = mode;
+        return *this;
+    }
+
+    /**
+     * @brief Get the acquisition mode
+     *
+     * @return LocationAcquisitionMode Configured acquisition mode
+     */
+    LocationAcquisitionMode acquisitionMode() const {
+        return _acquisitionMode;
+    }
+
+    /**
+     * @brief Set the encoding of published location events
+     *
+     * @param encoding Json for the "loc" event, Packed for the compact "locb" event
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& publishEncoding(LocationPublishEncoding encoding) {
+        _publishEncoding = encoding;
+        return *this;
+    }
+
+    /**
+     * @brief Get the encoding of published location events
+     *
+     * @return LocationPublishEncoding Configured encoding
+     */
+    LocationPublishEncoding publishEncoding() const {
+        return _publishEncoding;
+    }
+
+    /**
+     * @brief Batch published fixes into one delta encoded "locs" event
+     *
+     * Fixes are accumulated and published together once the batch holds the given number of fixes, the oldest fix
+     * reaches the given age, or the event is full.  A count of 0 or 1 publishes each fix on its own.
+     *
+     * @param maxCount Number of fixes that triggers a publish
+     * @param maxAgeSeconds Age, in seconds, of the oldest fix that triggers a publish, 0 for no age limit
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& publishBatch(unsigned int maxCount, unsigned int maxAgeSeconds) {
+        _batchCount = maxCount;
+        _batchAge = maxAgeSeconds;
+        return *this;
+    }
+
+    /**
+     * @brief Get the number of fixes that triggers a batch publish
+     *
+     * @return unsigned int Number of fixes, batching is disabled below 2
+     */
+    unsigned int publishBatchCount() const {
+        return _batchCount;
+    }
+
+    /**
+     * @brief Get the age of the oldest fix that triggers a batch publish
+     *
+     * @return unsigned int Age in seconds, 0 for no age limit
+     */
+    unsigned int publishBatchAge() const {
+        return _batchAge;
+    }
+
+    /**
+     * @brief Keep fixes published while offline in a ring log on the filesystem and replay them when connected
+     *
+     * Stored fixes are replayed oldest first as packed "locb" events, one every replay interval.
+     *
+     * @param slots Number of fixes held, 0 to disable, the oldest are overwritten when full
+     * @param replayIntervalMs Time, in milliseconds, between replayed events
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& storeOffline(unsigned int slots, unsigned int replayIntervalMs = LocationReplayIntervalDefault) {
+        _storeSlots = slots;
+        _replayInterval = replayIntervalMs;
+        return *this;
+    }
+
+    /**
+     * @brief Get the number of fixes held while offline
+     *
+     * @return unsigned int Number of fixes, 0 if disabled
+     */
+    unsigned int storeOfflineSlots() const {
+        return _storeSlots;
+    }
+
+    /**
+     * @brief Get the time between replayed events
+     *
+     * @return unsigned int Time in milliseconds
+     */
+    unsigned int storeOfflineReplayInterval() const {
+        return _replayInterval;
+    }
+
+    /**
+     * @brief Enable XTRA assistance data on the BG95
+     *
+     * Assistance data must be supplied by the application with SomLocation::injectAssistance().  The current time is
+     * injected before every session once the system time is valid.
+     *
+     * @param enable Enable XTRA in the modem
+     * @param refreshMarginMinutes Time, in minutes, before the data expires from which a refresh is due
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& assistance(bool enable, unsigned int refreshMarginMinutes = LocationAssistanceMarginDefault) {
+        _assistance = enable;
+        _assistanceMargin = refreshMarginMinutes;
+        return *this;
+    }
+
+    /**
+     * @brief Get whether XTRA assistance data is enabled
+     *
+     * @return bool XTRA enabled
+     */
+    bool assistance() const {
+        return _assistance;
+    }
+
+    /**
+     * @brief Get the time before assistance data expires from which a refresh is due
+     *
+     * @return unsigned int Time in minutes
+     */
+    unsigned int assistanceMargin() const {
+        return _assistanceMargin;
+    }
+
+    /**
+     * @brief Keep the last settled position across resets and inject the current time before each session
+     *
+     * The position is saved to the filesystem at the end of each session that settled.  Time injection enables XTRA
+     * in the BG95 and only happens once the system time is valid.
+     *
+     * @param enable Enable the reference
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& reference(bool enable) {
+        _reference = enable;
+        return *this;
+    }
+
+    /**
+     * @brief Get whether the reference position and time are enabled
+     *
+     * @return bool Reference enabled
+     */
+    bool reference() const {
+        return _reference;
+    }
+
+    /**
+     * @brief Set the session parameters used for a start type
+     *
+     * No start type has a policy by default, so every session uses the general settings until one is set.  For
+     * example a settling count of 1 for hot and warm starts lets them settle on the first fix that meets the
+     * thresholds.
+     *
+     * @param type Start type the parameters apply to
+     * @param policy Session parameters, fields left at 0 use the general settings
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& startPolicy(LocationStartType type, const LocationStartPolicy& policy) {
+        if (LocationStartType::Count > type) {
+            _startPolicy[(size_t)type] = policy;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Get the session parameters used for a start type
+     *
+     * @param type Start type
+     * @return LocationStartPolicy Session parameters, fields at 0 use the general settings
+     */
+    LocationStartPolicy startPolicy(LocationStartType type) const {
+        return (LocationStartType::Count > type) ? _startPolicy[(size_t)type] : LocationStartPolicy {};
+    }
+
+    /**
+     * @brief Share the BG95 RF path between GNSS and cellular with AT+QGPSCFG="priority"
+     *
+     * Until a session settles, GNSS is given priority in windows of at most the given length, separated by at least
+     * the gap so that the cellular stack can keep its connection.  Windows wait for cellular transfers reported by
+     * SomLocation::beginCellularActivity() or a connection attempt, for at most the maximum deferral, and a window in
+     * progress ends as soon as one is reported.
+     *
+     * @param gnssWindowMs Longest GNSS priority window in milliseconds, 0 to leave cellular priority unchanged
+     * @param cellularGapMs Shortest time, in milliseconds, between GNSS windows
+     * @param maximumDeferMs Longest time, in milliseconds, a window waits for cellular transfers
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& rfSharing(unsigned int gnssWindowMs, unsigned int cellularGapMs = LocationRfGapDefault,
+                                     unsigned int maximumDeferMs = LocationRfDeferDefault) {
+        _rfWindow = gnssWindowMs;
+        _rfGap = cellularGapMs;
+        _rfDefer = maximumDeferMs;
+        return *this;
+    }
+
+    /**
+     * @brief Get the longest GNSS priority window
+     *
+     * @return unsigned int Window in milliseconds, 0 if RF sharing is disabled
+     */
+    unsigned int rfSharingWindow() const {
+        return _rfWindow;
+    }
+
+    /**
+     * @brief Get the shortest time between GNSS priority windows
+     *
+     * @return unsigned int Gap in milliseconds
+     */
+    unsigned int rfSharingGap() const {
+        return _rfGap;
+    }
+
+    /**
+     * @brief Get the longest time a GNSS priority window waits for cellular transfers
+     *
+     * @return unsigned int Deferral in milliseconds
+     */
+    unsigned int rfSharingDefer() const {
+        return _rfDefer;
+    }
+
+    /**
+     * @brief Set the bounds of the motion adaptive duty cycle started with SomLocation::startDutyCycle()
+     *
+     * The minimum is raised to LocationDutyMinimumFloor, since an interval of zero would never grow and would keep
+     * the receiver acquiring back to back.
+     *
+     * @param minimumSeconds Shortest interval, in seconds, between acquisitions, used while turning, at least 1
+     * @param maximumSeconds Longest interval, in seconds, between acquisitions, reached while stationary
+     * @param distanceMeters Distance, in meters, to travel between acquisitions while moving
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& dutyCycle(unsigned int minimumSeconds, unsigned int maximumSeconds,
+                                     unsigned int distanceMeters = LocationDutyDistanceDefault) {
+        _dutyMinimum = (minimumSeconds < LocationDutyMinimumFloor) ? LocationDutyMinimumFloor : minimumSeconds;
+        _dutyMaximum = (maximumSeconds < _dutyMinimum) ? _dutyMinimum : maximumSeconds;
+        _dutyDistance = distanceMeters;
+        return *this;
+    }
+
+    /**
+     * @brief Get the shortest interval between duty cycle acquisitions
+     *
+     * @return unsigned int Interval in seconds
+     */
+    unsigned int dutyCycleMinimum() const {
+        return _dutyMinimum;
+    }
+
+    /**
+     * @brief Get the longest interval between duty cycle acquisitions
+     *
+     * @return unsigned int Interval in seconds
+     */
+    unsigned int dutyCycleMaximum() const {
+        return _dutyMaximum;
+    }
+
+    /**
+     * @brief Get the distance to travel between duty cycle acquisitions while moving
+     *
+     * @return unsigned int Distance in meters
+     */
+    unsigned int dutyCycleDistance() const {
+        return _dutyDistance;
+    }
+
+    /**
+     * @brief Set the range of intervals between position polls
+     *
+     * While the modem reports no fix the interval grows from the minimum towards the maximum, and it returns to the
+     * minimum as soon as fixes arrive.  Setting both to the same value polls at a fixed rate.
+     *
+     * @param minimumMs Interval, in milliseconds, used while fixes are arriving
+     * @param maximumMs Longest interval, in milliseconds, used while there is no fix
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& pollInterval(unsigned int minimumMs, unsigned int maximumMs) {
+        _pollMinimum = minimumMs;
+        _pollMaximum = (maximumMs < minimumMs) ? minimumMs : maximumMs;
+        return *this;
+    }
+
+    /**
+     * @brief Get the interval used between position polls while fixes are arriving
+     *
+     * @return unsigned int Interval in milliseconds
+     */
+    unsigned int pollIntervalMinimum() const {
+        return _pollMinimum;
+    }
+
+    /**
+     * @brief Get the longest interval used between position polls while there is no fix
+     *
+     * @return unsigned int Interval in milliseconds
+     */
+    unsigned int pollIntervalMaximum() const {
+        return _pollMaximum;
+    }
+
+    /**
+     * @brief Set the factor applied to the poll interval after each poll without a fix
+     *
+     * @param factor Multiplier, 1.0 to 10.0
+     * @return LocationConfiguration&
+     */
+    LocationConfiguration& pollBackoff(float factor) {
+        if (1.0 > factor)
+            factor = 1.0;
+        else if (10.0 < factor)
+            factor = 10.0;
+        _pollBackoff = factor;
+        return *this;
+    }
+
+    /**
+     * @brief Get the factor applied to the poll interval after each poll without a fix
+     *
+     * @return float Multiplier
+     */
+    float pollBackoff() const {
+        return _pollBackoff;
+    }
+
     LocationConfiguration& operator=(const LocationConfiguration& rhs) {
         if (this == &rhs) {
             return *this;
@@ -168,7 +574,29 @@ public:
         this->_constellations = rhs._constellations;
         this->_antennaPin = rhs._antennaPin;
         this->_hdop = rhs._hdop;
+        this->_hacc = rhs._hacc;
         this->_maxFixSeconds = rhs._maxFixSeconds;
+        this->_acquisitionMode = rhs._acquisitionMode;
+        this->_pollMinimum = rhs._pollMinimum;
+        this->_pollMaximum = rhs._pollMaximum;
+        this->_pollBackoff = rhs._pollBackoff;
+        this->_publishEncoding = rhs._publishEncoding;
+        this->_batchCount = rhs._batchCount;
+        this->_batchAge = rhs._batchAge;
+        this->_storeSlots = rhs._storeSlots;
+        this->_replayInterval = rhs._replayInterval;
+        this->_assistance = rhs._assistance;
+        this->_assistanceMargin = rhs._assistanceMargin;
+        this->_reference = rhs._reference;
+        for (size_t i = 0; i < (size_t)LocationStartType::Count; i++) {
+            this->_startPolicy[i] = rhs._startPolicy[i];
+        }
+        this->_rfWindow = rhs._rfWindow;
+        this->_rfGap = rhs._rfGap;
+        this->_rfDefer = rhs._rfDefer;
+        this->_dutyMinimum = rhs._dutyMinimum;
+        this->_dutyMaximum = rhs._dutyMaximum;
+        this->_dutyDistance = rhs._dutyDistance;
 
         return *this;
     }
@@ -179,4 +607,23 @@ private:
     int _hdop;
     float _hacc;
     unsigned int _maxFixSeconds;
+    LocationAcquisitionMode _acquisitionMode;
+    unsigned int _pollMinimum;
+    unsigned int _pollMaximum;
+    float _pollBackoff;
+    LocationPublishEncoding _publishEncoding;
+    unsigned int _batchCount;
+    unsigned int _batchAge;
+    unsigned int _storeSlots;
+    unsigned int _replayInterval;
+    bool _assistance;
+    unsigned int _assistanceMargin;
+    bool _reference;
+    LocationStartPolicy _startPolicy[(size_t)LocationStartType::Count];
+    unsigned int _rfWindow;
+    unsigned int _rfGap;
+    unsigned int _rfDefer;
+    unsigned int _dutyMinimum;
+    unsigned int _dutyMaximum;
+    unsigned int _dutyDistance;
 };
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include "location_parser.h"
+#include "location_time.h"
+
+namespace {
+
+constexpr char QLOC_PREFIX[] = "+QGPSLOC:";
+constexpr char XTRA_DATA_PREFIX[] = "+QGPSXTRADATA:";
+constexpr char EPE_PREFIX[] = "+QGPSCFG:";
+constexpr char EPE_NAME[] = "\"estimation_error\"";
+constexpr char CME_PREFIX[] = "+CME ERROR:";
+constexpr uint32_t FIXED_OVERFLOW_LIMIT {429496729u}; // UINT32_MAX / 10
+
+bool isFieldEnd(char c) {
+    return ('\0' == c) || (',' == c) || ('\r' == c) || ('\n' == c) || (' ' == c);
+}
+
+const char* skipSpaces(const char* str) {
+    while ((' ' == *str) || ('\r' == *str) || ('\n' == *str)) {
+        ++str;
+    }
+    return str;
+}
+
+} // anonymous namespace
+
+const char* LocationParser::nextField(const char* str) {
+    while (('\0' != *str) && (',' != *str)) {
+        ++str;
+    }
+    return (',' == *str) ? str + 1 : nullptr;
+}
+
+bool LocationParser::parseUnsigned(const char*& str, int maxDigits, uint32_t& value) {
+    auto p = str;
+    uint32_t acc = 0;
+    int count = 0;
+
+    while (isDigit(*p) && ((0 == maxDigits) || (count < maxDigits))) {
+        acc = acc * 10 + (*p - '0');
+        ++count;
+        ++p;
+    }
+
+    if (0 == count) {
+        return false;
+    }
+
+    value = acc;
+    str = p;
+    return true;
+}
+
+bool LocationParser::parseFixed(const char*& str, int decimals, int32_t& value) {
+    auto p = str;
+    bool negative = false;
+    bool digits = false;
+    bool overflow = false;
+    bool roundUp = false;
+    uint32_t acc = 0;
+
+    if (('-' == *p) || ('+' == *p)) {
+        negative = ('-' == *p);
+        ++p;
+    }
+
+    while (isDigit(*p)) {
+        if (acc < FIXED_OVERFLOW_LIMIT) {
+            acc = acc * 10 + (*p - '0');
+        }
+        else {
+            overflow = true;
+        }
+        digits = true;
+        ++p;
+    }
+
+    int places = 0;
+    if ('.' == *p) {
+        ++p;
+        while (isDigit(*p)) {
+            if (places < decimals) {
+                if (acc < FIXED_OVERFLOW_LIMIT) {
+                    acc = acc * 10 + (*p - '0');
+                }
+                else {
+                    overflow = true;
+                }
+                ++places;
+            }
+            else if (places == decimals) {
+                // First dropped digit decides rounding, the rest are ignored
+                roundUp = ('5' <= *p);
+                ++places;
+            }
+            digits = true;
+            ++p;
+        }
+    }
+
+    if (!digits) {
+        return false;
+    }
+
+    for (; places < decimals; ++places) {
+        if (acc < FIXED_OVERFLOW_LIMIT) {
+            acc *= 10;
+        }
+        else {
+            overflow = true;
+        }
+    }
+    if (roundUp) {
+        ++acc;
+    }
+    if (overflow || (acc > (uint32_t)INT32_MAX)) {
+        acc = INT32_MAX;
+    }
+
+    value = (negative) ? -(int32_t)acc : (int32_t)acc;
+    str = p;
+    return true;
+}
+
+int LocationParser::parseQloc(const char* buf, LocationQloc& qloc) {
+    qloc = {};
+
+    if (!buf) {
+        return -1;
+    }
+
+    auto p = skipSpaces(buf);
+    if (0 != strncmp(p, QLOC_PREFIX, sizeof(QLOC_PREFIX) - 1)) {
+        return -1;
+    }
+    p = skipSpaces(p + sizeof(QLOC_PREFIX) - 1);
+
+    // The general form of the AT command response is as follows
+    // <UTC HHMMSS.hh>,<latitude (-)dd.ddddd>,<longitude (-)ddd.ddddd>,<HDOP>,<altitude>,<fix>,<COG ddd.mm>,<spkm>,<spkn>,<date DDmmyy>,<nsat>
+    uint32_t hour, minute, second;
+    if (parseUnsigned(p, 2, hour) && parseUnsigned(p, 2, minute) && parseUnsigned(p, 2, second)) {
+        uint32_t millisecond = 0;
+        if ('.' == *p) {
+            ++p;
+            int places = 0;
+            for (; isDigit(*p); ++p) {
+                if (places < 3) {
+                    millisecond = millisecond * 10 + (*p - '0');
+                    ++places;
+                }
+            }
+            for (; places < 3; ++places) {
+                millisecond *= 10;
+            }
+        }
+        if (isFieldEnd(*p)) {
+            qloc.hour = hour;
+            qloc.minute = minute;
+            qloc.second = second;
+            qloc.millisecond = millisecond;
+            qloc.present |= LOCATION_QLOC_UTC;
+        }
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    if (parseFixed(p, LatLonDecimals, qloc.latitude) && isFieldEnd(*p)) {
+        qloc.present |= LOCATION_QLOC_LATITUDE;
+    }
+    else {
+        qloc.latitude = 0;
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    if (parseFixed(p, LatLonDecimals, qloc.longitude) && isFieldEnd(*p)) {
+        qloc.present |= LOCATION_QLOC_LONGITUDE;
+    }
+    else {
+        qloc.longitude = 0;
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    if (parseFixed(p, HdopDecimals, qloc.hdop) && isFieldEnd(*p)) {
+        qloc.present |= LOCATION_QLOC_HDOP;
+    }
+    else {
+        qloc.hdop = 0;
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    if (parseFixed(p, AltitudeDecimals, qloc.altitude) && isFieldEnd(*p)) {
+        qloc.present |= LOCATION_QLOC_ALTITUDE;
+    }
+    else {
+        qloc.altitude = 0;
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    uint32_t fix;
+    if (parseUnsigned(p, 0, fix) && isFieldEnd(*p)) {
+        qloc.fix = fix;
+        qloc.present |= LOCATION_QLOC_FIX;
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    uint32_t cogDegrees, cogMinutes = 0;
+    if (parseUnsigned(p, 0, cogDegrees)) {
+        if ('.' == *p) {
+            ++p;
+            parseUnsigned(p, 2, cogMinutes);
+        }
+        if (isFieldEnd(*p)) {
+            qloc.cogDegrees = cogDegrees;
+            qloc.cogMinutes = cogMinutes;
+            qloc.present |= LOCATION_QLOC_COG;
+        }
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    if (parseFixed(p, SpeedDecimals, qloc.speedKmph) && isFieldEnd(*p)) {
+        qloc.present |= LOCATION_QLOC_SPEED_KMPH;
+    }
+    else {
+        qloc.speedKmph = 0;
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    if (parseFixed(p, SpeedDecimals, qloc.speedKnots) && isFieldEnd(*p)) {
+        qloc.present |= LOCATION_QLOC_SPEED_KNOTS;
+    }
+    else {
+        qloc.speedKnots = 0;
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    uint32_t day, month, year;
+    if (parseUnsigned(p, 2, day) && parseUnsigned(p, 2, month) && parseUnsigned(p, 2, year) && isFieldEnd(*p)) {
+        qloc.day = day;
+        qloc.month = month;
+        qloc.year = year;
+        qloc.present |= LOCATION_QLOC_DATE;
+    }
+
+    if (!(p = nextField(p))) {
+        return 0;
+    }
+    uint32_t nsat;
+    if (parseUnsigned(p, 0, nsat) && isFieldEnd(*p)) {
+        qloc.nsat = nsat;
+        qloc.present |= LOCATION_QLOC_NSAT;
+    }
+
+    return 0;
+}
+
+int LocationParser::parseEpe(const char* buf, LocationEpe& epe) {
+    epe = {};
+
+    if (!buf) {
+        return -1;
+    }
+
+    auto p = skipSpaces(buf);
+    if (0 != strncmp(p, EPE_PREFIX, sizeof(EPE_PREFIX) - 1)) {
+        return -1;
+    }
+    p = skipSpaces(p + sizeof(EPE_PREFIX) - 1);
+    if (0 != strncmp(p, EPE_NAME, sizeof(EPE_NAME) - 1)) {
+        return -1;
+    }
+    p += sizeof(EPE_NAME) - 1;
+
+    // "estimation_error",<h_acc>,<v_acc>,<speed_acc>,<head_acc>
+    const struct {
+        int32_t* value;
+        uint32_t field;
+    } fields[] = {
+        {&epe.horizontal, LOCATION_EPE_HORIZONTAL},
+        {&epe.vertical, LOCATION_EPE_VERTICAL},
+        {&epe.speed, LOCATION_EPE_SPEED},
+        {&epe.heading, LOCATION_EPE_HEADING},
+    };
+    for (auto& field : fields) {
+        if (!(p = nextField(p))) {
+            return 0;
+        }
+        if (parseFixed(p, EpeDecimals, *field.value) && isFieldEnd(*p)) {
+            epe.present |= field.field;
+        }
+        else {
+            *field.value = 0;
+        }
+    }
+
+    return 0;
+}
+
+int LocationParser::parseCmeError(const char* buf, uint32_t& code) {
+    if (!buf) {
+        return -1;
+    }
+
+    auto p = skipSpaces(buf);
+    if (0 != strncmp(p, CME_PREFIX, sizeof(CME_PREFIX) - 1)) {
+        return -1;
+    }
+    p = skipSpaces(p + sizeof(CME_PREFIX) - 1);
+
+    uint32_t value;
+    if (!parseUnsigned(p, 0, value) || !isFieldEnd(*p)) {
+        return -1;
+    }
+
+    code = value;
+    return 0;
+}
+
+int LocationParser::parseXtraData(const char* buf, uint32_t& durationMinutes, time_t& start) {
+    if (!buf) {
+        return -1;
+    }
+
+    auto p = skipSpaces(buf);
+    if (0 != strncmp(p, XTRA_DATA_PREFIX, sizeof(XTRA_DATA_PREFIX) - 1)) {
+        return -1;
+    }
+    p = skipSpaces(p + sizeof(XTRA_DATA_PREFIX) - 1);
+
+    // <duration>,"<YYYY/MM/DD,hh:mm:ss>"
+    uint32_t duration, year, month, day, hour, minute, second;
+    if (!parseUnsigned(p, 0, duration) || (',' != *p++) || ('"' != *p++) ||
+        !parseUnsigned(p, 4, year) || ('/' != *p++) || !parseUnsigned(p, 2, month) || ('/' != *p++) ||
+        !parseUnsigned(p, 2, day) || (',' != *p++) ||
+        !parseUnsigned(p, 2, hour) || (':' != *p++) || !parseUnsigned(p, 2, minute) || (':' != *p++) ||
+        !parseUnsigned(p, 2, second) || ('"' != *p)) {
+        return -1;
+    }
+    if ((1 > month) || (12 < month) || (1 > day) || (31 < day) || (23 < hour) || (59 < minute) || (60 < second)) {
+        return -1;
+    }
+
+    durationMinutes = duration;
+    start = LocationTime::epochFromUtc((int32_t)year, month, day, hour, minute, second);
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+/**
+ * @brief Fields present in a parsed +QGPSLOC response
+ *
+ */
+enum LocationQlocField {
+    LOCATION_QLOC_UTC               = (1 << 0),
+    LOCATION_QLOC_LATITUDE          = (1 << 1),
+    LOCATION_QLOC_LONGITUDE         = (1 << 2),
+    LOCATION_QLOC_HDOP              = (1 << 3),
+    LOCATION_QLOC_ALTITUDE          = (1 << 4),
+    LOCATION_QLOC_FIX               = (1 << 5),
+    LOCATION_QLOC_COG               = (1 << 6),
+    LOCATION_QLOC_SPEED_KMPH        = (1 << 7),
+    LOCATION_QLOC_SPEED_KNOTS       = (1 << 8),
+    LOCATION_QLOC_DATE              = (1 << 9),
+    LOCATION_QLOC_NSAT              = (1 << 10),
+};
+
+/**
+ * @brief Fixed-point fields of an AT+QGPSLOC=2 response.
+ *
+ */
+struct LocationQloc {
+    uint32_t present;               /**< Bitmap of LocationQlocField values found in the response */
+    uint8_t hour;                   /**< UTC hour, 0 to 23 */
+    uint8_t minute;                 /**< UTC minute, 0 to 59 */
+    uint8_t second;                 /**< UTC second, 0 to 59 */
+    uint16_t millisecond;           /**< UTC milliseconds */
+    uint8_t day;                    /**< UTC day of month, 1 to 31 */
+    uint8_t month;                  /**< UTC month, 1 to 12 */
+    uint8_t year;                   /**< UTC year since 2000 */
+    int32_t latitude;               /**< Latitude in 1e-7 degrees */
+    int32_t longitude;              /**< Longitude in 1e-7 degrees */
+    int32_t hdop;                   /**< Horizontal dilution of precision in hundredths */
+    int32_t altitude;               /**< Altitude in millimeters */
+    uint8_t fix;                    /**< Fix type, 2 for 2D and 3 for 3D */
+    uint16_t cogDegrees;            /**< Course over ground, whole degrees */
+    uint8_t cogMinutes;             /**< Course over ground, minutes */
+    int32_t speedKmph;              /**< Speed over ground in hundredths of km/h */
+    int32_t speedKnots;             /**< Speed over ground in hundredths of knots */
+    uint8_t nsat;                   /**< Number of satellites in use */
+};
+
+/**
+ * @brief Fields present in a parsed +QGPSCFG: "estimation_error" response
+ *
+ */
+enum LocationEpeField {
+    LOCATION_EPE_HORIZONTAL         = (1 << 0),
+    LOCATION_EPE_VERTICAL           = (1 << 1),
+    LOCATION_EPE_SPEED              = (1 << 2),
+    LOCATION_EPE_HEADING            = (1 << 3),
+};
+
+/**
+ * @brief Fixed-point fields of an AT+QGPSCFG="estimation_error" response.
+ *
+ */
+struct LocationEpe {
+    uint32_t present;               /**< Bitmap of LocationEpeField values found in the response */
+    int32_t horizontal;             /**< Horizontal position error in millimeters */
+    int32_t vertical;               /**< Vertical position error in millimeters */
+    int32_t speed;                  /**< Speed error in millimeters per second */
+    int32_t heading;                /**< Heading error in thousandths of degrees */
+};
+
+/**
+ * @brief Single-pass parsers for modem GNSS responses
+ *
+ */
+class LocationParser {
+public:
+    static constexpr int LatLonDecimals {7};        /**< Decimal places kept for latitude and longitude */
+    static constexpr int HdopDecimals {2};          /**< Decimal places kept for HDOP */
+    static constexpr int AltitudeDecimals {3};      /**< Decimal places kept for altitude */
+    static constexpr int SpeedDecimals {2};         /**< Decimal places kept for speed */
+    static constexpr int EpeDecimals {3};           /**< Decimal places kept for estimated errors */
+
+    /**
+     * @brief Parse a +QGPSLOC response line, in AT+QGPSLOC=2 format, into fixed-point fields
+     *
+     * Empty or malformed fields are skipped and left cleared; the present bitmap reports which fields were read.
+     *
+     * @param buf Null terminated response line
+     * @param qloc Parsed fields
+     * @retval 0 Success
+     * @retval -1 Response is not a +QGPSLOC line
+     */
+    static int parseQloc(const char* buf, LocationQloc& qloc);
+
+    /**
+     * @brief Parse a +QGPSCFG: "estimation_error" response line into fixed-point fields
+     *
+     * Empty or malformed fields are skipped and left cleared; the present bitmap reports which fields were read.
+     *
+     * @param buf Null terminated response line, for example +QGPSCFG: "estimation_error",3.2,4.8,0.1,1.9
+     * @param epe Parsed fields
+     * @retval 0 Success
+     * @retval -1 Response is not an estimation error line
+     */
+    static int parseEpe(const char* buf, LocationEpe& epe);
+
+    /**
+     * @brief Parse a +CME ERROR response line in numeric format
+     *
+     * @param buf Null terminated response line, for example +CME ERROR: 516
+     * @param code Error code
+     * @retval 0 Success
+     * @retval -1 Response is not a +CME ERROR line or has no numeric code
+     */
+    static int parseCmeError(const char* buf, uint32_t& code);
+
+    /**
+     * @brief Parse a +QGPSXTRADATA response line giving the validity of the loaded XTRA data
+     *
+     * @param buf Null terminated response line, for example +QGPSXTRADATA: 10080,"2024/05/21,08:00:00"
+     * @param durationMinutes Validity of the data in minutes, 0 when no data is loaded
+     * @param start Start of the validity in seconds since the epoch
+     * @retval 0 Success
+     * @retval -1 Response is not a +QGPSXTRADATA line or is malformed
+     */
+    static int parseXtraData(const char* buf, uint32_t& durationMinutes, time_t& start);
+
+    /**
+     * @brief Parse a signed decimal number into a fixed-point integer
+     *
+     * Digits beyond the requested number of decimals are rounded away.  Parsing stops at the first character that
+     * is not part of the number.
+     *
+     * @param str Pointer to the number, advanced past the parsed characters
+     * @param decimals Number of decimal places to keep
+     * @param value Parsed value scaled by 10^decimals
+     * @return true At least one digit was parsed
+     * @return false No number present
+     */
+    static bool parseFixed(const char*& str, int decimals, int32_t& value);
+
+    /**
+     * @brief Parse an unsigned decimal integer
+     *
+     * @param str Pointer to the number, advanced past the parsed characters
+     * @param maxDigits Maximum number of digits to consume, 0 for no limit
+     * @param value Parsed value
+     * @return true At least one digit was parsed
+     * @return false No number present
+     */
+    static bool parseUnsigned(const char*& str, int maxDigits, uint32_t& value);
+
+private:
+    static bool isDigit(char c) {
+        return ('0' <= c) && ('9' >= c);
+    }
+
+    static const char* nextField(const char* str);
+};
@@ -16,8 +16,17 @@
 
 #pragma once
 
+#include <cstdint>
 #include <ctime>
 
+#ifndef PLATFORM_ID
+typedef int32_t time32_t;   /**< Device OS epoch time, for host builds of the Particle-free units */
+#endif // PLATFORM_ID
+
+#ifndef LOCATION_FIXED_POINT_COORDINATES
+#define LOCATION_FIXED_POINT_COORDINATES (0)   /**< Set to 1 to store coordinates as 1e-7 degree integers */
+#endif // LOCATION_FIXED_POINT_COORDINATES
+
 /**
  * @brief Type of location fix.
  *
@@ -28,6 +37,70 @@ enum LocationFix {
     LOCATION_FIX_3D,
 };
 
+/**
+ * @brief Receiver start type of the session that produced a fix.
+ *
+ */
+enum class LocationStartType : uint8_t {
+    Unknown,                /**< Not classified */
+    Hot,                    /**< A position was fixed recently enough for the ephemeris to be current */
+    Warm,                   /**< A position was fixed in the last days, or assistance data is valid */
+    Cold,                   /**< Nothing is known to the receiver */
+    Count,
+};
+
+/**
+ * @brief Coordinate traits storing degrees as double precision floating point.
+ *
+ */
+struct LocationCoordinateDouble {
+    using type = double;
+
+    static constexpr type fromE7(int32_t e7) {
+        return (double)e7 * 1.0e-7;
+    }
+
+    static constexpr int32_t toE7(type value) {
+        return (int32_t)((0.0 > value) ? value * 1.0e7 - 0.5 : value * 1.0e7 + 0.5);
+    }
+
+    static constexpr double toDegrees(type value) {
+        return value;
+    }
+};
+
+/**
+ * @brief Coordinate traits storing degrees as integers in units of 1e-7 degrees.
+ *
+ */
+struct LocationCoordinateFixed {
+    using type = int32_t;
+
+    static constexpr type fromE7(int32_t e7) {
+        return e7;
+    }
+
+    static constexpr int32_t toE7(type value) {
+        return value;
+    }
+
+    static constexpr double toDegrees(type value) {
+        return (double)value * 1.0e-7;
+    }
+};
+
+#if LOCATION_FIXED_POINT_COORDINATES
+using LocationCoordinateTraits = LocationCoordinateFixed;
+#else
+using LocationCoordinateTraits = LocationCoordinateDouble;
+#endif // LOCATION_FIXED_POINT_COORDINATES
+
+/**
+ * @brief Storage type of latitude and longitude in LocationPoint.
+ *
+ */
+using LocationCoordinate = LocationCoordinateTraits::type;
+
 /**
  * @brief Type of point coordinates of the given event.
  *
@@ -36,8 +109,8 @@ struct LocationPoint {
     unsigned int fix;               /**< Indication of GNSS locked status */
     time_t epochTime;               /**< Epoch time from device sources */
     time32_t systemTime;            /**< System epoch time */
-    double latitude;                /**< Point latitude in degrees */
-    double longitude;               /**< Point longitude in degrees */
+    LocationCoordinate latitude;    /**< Point latitude, see LocationCoordinateTraits for units */
+    LocationCoordinate longitude;   /**< Point longitude, see LocationCoordinateTraits for units */
     float altitude;                 /**< Point altitude in meters */
     float speed;                    /**< Point speed in meters per second */
     float heading;                  /**< Point heading in degrees */
@@ -47,4 +120,5 @@ struct LocationPoint {
     float verticalDop;              /**< Point vertical dilution of precision */
     float timeToFirstFix;           /**< Time-to-first-fix in seconds */
     unsigned int satsInUse;         /**< Point satellites in use */
+    LocationStartType startType;    /**< Start type of the session that produced the point */
 };
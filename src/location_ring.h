@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Read position of a consumer of a LocationRing
+ *
+ */
+struct LocationRingCursor {
+    uint32_t next {};               /**< Sequence number of the next record to read */
+    uint32_t overruns {};           /**< Records overwritten before this consumer could read them */
+};
+
+/**
+ * @brief Fixed capacity, lock-free ring written by a single producer
+ *
+ * The producer never blocks and always overwrites the oldest record.  Any number of consumers may read at their own
+ * pace, each with its own cursor; records a consumer falls too far behind to read are counted as overruns on its
+ * cursor.  Each slot is guarded by a sequence number so that a consumer detects a record being overwritten while it
+ * is copied.
+ *
+ * @tparam T Trivially copyable record type
+ * @tparam N Capacity, must be a power of two
+ */
+template <typename T, size_t N>
+class LocationRing {
+    static_assert((0 < N) && (0 == (N & (N - 1))), "Ring capacity must be a power of two");
+
+public:
+    /**
+     * @brief Append a record, overwriting the oldest one when full.  Must only be called from the producer thread.
+     *
+     * @param record Record to append
+     */
+    void push(const T& record) {
+        auto head = _head.load(std::memory_order_relaxed);
+        auto& slot = _slots[head & (N - 1)];
+
+        // Odd sequence marks the slot as being written
+        slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record = record;
+        slot.sequence.store(2 * head + 2, std::memory_order_release);
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Get a cursor positioned after the most recent record
+     *
+     * @param backlog Position the cursor at the oldest record still held instead
+     * @return LocationRingCursor
+     */
+    LocationRingCursor cursor(bool backlog = false) const {
+        LocationRingCursor cursor;
+        auto head = _head.load(std::memory_order_acquire);
+        cursor.next = (backlog) ? ((head > N) ? head - N : 0) : head;
+        return cursor;
+    }
+
+    /**
+     * @brief Read the next record for a consumer
+     *
+     * @param cursor Consumer cursor, advanced past the record read and any records lost to overruns
+     * @param record Record read
+     * @return true A record was read
+     * @return false No new records
+     */
+    bool read(LocationRingCursor& cursor, T& record) const {
+        for (;;) {
+            auto head = _head.load(std::memory_order_acquire);
+            if (cursor.next == head) {
+                return false;
+            }
+            if ((head - cursor.next) > N) {
+                cursor.overruns += head - cursor.next - N;
+                cursor.next = head - N;
+            }
+
+            auto& slot = _slots[cursor.next & (N - 1)];
+            auto expected = 2 * cursor.next + 2;
+            auto before = slot.sequence.load(std::memory_order_acquire);
+            if (before == expected) {
+                record = slot.record;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+                    cursor.next++;
+                    return true;
+                }
+            }
+
+            // The producer lapped this consumer while reading
+            cursor.overruns++;
+            cursor.next++;
+        }
+    }
+
+    /**
+     * @brief Get the number of records written since startup
+     *
+     * @return uint32_t Number of records
+     */
+    uint32_t written() const {
+        return _head.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence {0};
+        T record {};
+    };
+
+    Slot _slots[N];
+    std::atomic<uint32_t> _head {0};
+};
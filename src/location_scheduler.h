@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief Chooses the interval between position polls during an acquisition
+ *
+ * Polls back off geometrically while the receiver has not produced a fix, and drop to the minimum interval for the
+ * remainder of the session once the first fix arrives so that settling completes as quickly as possible.
+ *
+ */
+class LocationPollScheduler {
+public:
+    /**
+     * @brief Start scheduling a new acquisition session
+     *
+     * @param minimumMs Interval, in milliseconds, used once fixes arrive
+     * @param maximumMs Longest interval, in milliseconds, used before the first fix
+     * @param backoff Factor applied to the interval after each poll without a fix
+     */
+    void begin(unsigned int minimumMs, unsigned int maximumMs, float backoff) {
+        _minimum = minimumMs;
+        _maximum = (maximumMs < minimumMs) ? minimumMs : maximumMs;
+        _backoff = backoff;
+        _interval = minimumMs;
+        _fixed = false;
+    }
+
+    /**
+     * @brief Record the outcome of a poll and get the time until the next one
+     *
+     * @param fixed Poll returned a position fix
+     * @return unsigned int Milliseconds until the next poll
+     */
+    unsigned int next(bool fixed) {
+        if (fixed || _fixed) {
+            _fixed = true;
+            _interval = _minimum;
+            return _interval;
+        }
+
+        auto interval = _interval;
+        auto grown = (float)_interval * _backoff;
+        _interval = (grown >= (float)_maximum) ? _maximum : (unsigned int)grown;
+        return interval;
+    }
+
+private:
+    unsigned int _minimum {};
+    unsigned int _maximum {};
+    float _backoff {1.0};
+    unsigned int _interval {};
+    bool _fixed {false};
+};
+
+/**
+ * @brief Owner of the RF path shared by GNSS and LTE on the BG95
+ *
+ */
+enum class LocationRfOwner {
+    Cellular,               /**< WWAN priority, GNSS only receives while the radio is idle */
+    Gnss,                   /**< GNSS priority, cellular transfers wait */
+};
+
+/**
+ * @brief Grants GNSS windows of uninterrupted RF priority during a session
+ *
+ * GNSS is granted priority for at most one window at a time and cellular keeps the RF path for at least the gap
+ * between windows.  A window is not started while cellular reports a pending transfer, unless the transfer keeps
+ * GNSS waiting longer than the maximum deferral, and a window ends at the first call that reports cellular busy,
+ * unless it was started after such a deferral.  Once the session settles cellular keeps priority.
+ *
+ */
+class LocationRfScheduler {
+public:
+    /**
+     * @brief Start scheduling a new session
+     *
+     * @param windowMs Longest GNSS priority window in milliseconds, 0 to leave cellular priority unchanged
+     * @param gapMs Shortest time, in milliseconds, between GNSS windows
+     * @param maximumDeferMs Longest time, in milliseconds, a window waits for cellular transfers
+     */
+    void begin(unsigned int windowMs, unsigned int gapMs, unsigned int maximumDeferMs) {
+        _window = windowMs;
+        _gap = gapMs;
+        _maximumDefer = maximumDeferMs;
+        _owner = LocationRfOwner::Cellular;
+        _windowed = false;
+        _deferring = false;
+        _forced = false;
+        _grantedMs = 0;
+    }
+
+    /**
+     * @brief Choose the owner of the RF path
+     *
+     * @param nowMs Current monotonic time in milliseconds
+     * @param cellularBusy A cellular transfer is pending or in progress
+     * @param settled The session has its position
+     * @return LocationRfOwner Owner until the next call
+     */
+    LocationRfOwner next(uint64_t nowMs, bool cellularBusy, bool settled) {
+        if (0 == _window) {
+            return LocationRfOwner::Cellular;
+        }
+
+        if (LocationRfOwner::Gnss == _owner) {
+            // Cellular takes the RF path back as soon as it needs it, unless it already held up this window too long
+            if (settled || ((nowMs - _windowStart) >= _window) || (cellularBusy && !_forced)) {
+                release(nowMs);
+            }
+            return _owner;
+        }
+
+        if (settled || (_windowed && ((nowMs - _windowEnd) < _gap))) {
+            return _owner;
+        }
+        if (cellularBusy) {
+            if (!_deferring) {
+                _deferring = true;
+                _deferStart = nowMs;
+            }
+            if ((nowMs - _deferStart) < _maximumDefer) {
+                return _owner;
+            }
+        }
+
+        _owner = LocationRfOwner::Gnss;
+        _windowStart = nowMs;
+        _forced = cellularBusy;
+        _deferring = false;
+        return _owner;
+    }
+
+    /**
+     * @brief End the GNSS window in progress, if any
+     *
+     * @param nowMs Current monotonic time in milliseconds
+     */
+    void release(uint64_t nowMs) {
+        if (LocationRfOwner::Gnss != _owner) {
+            return;
+        }
+        _grantedMs += (uint32_t)(nowMs - _windowStart);
+        _windowEnd = nowMs;
+        _windowed = true;
+        _owner = LocationRfOwner::Cellular;
+    }
+
+    /**
+     * @brief Get the current owner of the RF path
+     *
+     * @return LocationRfOwner Current owner
+     */
+    LocationRfOwner owner() const {
+        return _owner;
+    }
+
+    /**
+     * @brief Get the time GNSS has had priority during the session
+     *
+     * @param nowMs Current monotonic time in milliseconds
+     * @return uint32_t Milliseconds of GNSS priority, including the window in progress
+     */
+    uint32_t grantedMs(uint64_t nowMs) const {
+        return _grantedMs + ((LocationRfOwner::Gnss == _owner) ? (uint32_t)(nowMs - _windowStart) : 0);
+    }
+
+private:
+    unsigned int _window {};
+    unsigned int _gap {};
+    unsigned int _maximumDefer {};
+    LocationRfOwner _owner {LocationRfOwner::Cellular};
+    uint64_t _windowStart {};
+    uint64_t _windowEnd {};
+    bool _windowed {false};
+    uint64_t _deferStart {};
+    bool _deferring {false};
+    bool _forced {false};
+    uint32_t _grantedMs {};
+};
+
+/**
+ * @brief Chooses the time until the next acquisition of a duty cycle from recent motion
+ *
+ * Consecutive fixes within the stationary radius, widened by the reported accuracy, and below walking speed count as
+ * stationary and double the interval up to the maximum.  While moving, the interval is the time to cover the target
+ * distance at the current speed, and drops to the minimum on a change of heading or on movement too slow to measure.
+ * Acquisitions without a fix also double the interval, since the device is likely indoors or covered.
+ *
+ */
+class LocationDutyScheduler {
+public:
+    static constexpr float StationaryRadiusMeters {25.0f};  /**< Movement within this distance is not motion */
+    static constexpr float MovingSpeed {1.0f};              /**< Speed, in meters per second, counted as motion */
+    static constexpr float TurnDegrees {30.0f};             /**< Heading change that shortens the interval */
+
+    /**
+     * @brief Start a new duty cycle
+     *
+     * @param minimumMs Shortest interval in milliseconds
+     * @param maximumMs Longest interval in milliseconds
+     * @param distanceMeters Distance to travel between acquisitions while moving
+     */
+    void begin(unsigned int minimumMs, unsigned int maximumMs, unsigned int distanceMeters) {
+        _minimum = minimumMs;
+        _maximum = (maximumMs < minimumMs) ? minimumMs : maximumMs;
+        _distance = (float)distanceMeters;
+        _interval = minimumMs;
+        _anchored = false;
+        _stationary = 0;
+    }
+
+    /**
+     * @brief Record the outcome of an acquisition and get the time until the next one
+     *
+     * @param fixed Acquisition settled on a position, the remaining arguments are ignored otherwise
+     * @param latitude Latitude in 1e-7 degrees
+     * @param longitude Longitude in 1e-7 degrees
+     * @param speed Speed in meters per second
+     * @param heading Heading in degrees
+     * @param accuracy Horizontal accuracy in meters, 0 if unknown
+     * @return unsigned int Milliseconds until the next acquisition
+     */
+    unsigned int next(bool fixed, int32_t latitude, int32_t longitude, float speed, float heading, float accuracy) {
+        if (!fixed) {
+            return grow();
+        }
+
+        if (!_anchored) {
+            anchor(latitude, longitude, heading);
+            _interval = _minimum;
+            return _interval;
+        }
+
+        auto moved = distanceMeters(_latitude, _longitude, latitude, longitude);
+        if ((MovingSpeed > speed) && (moved <= (StationaryRadiusMeters + accuracy))) {
+            // Keep the anchor so that slow drift still adds up to motion
+            _stationary++;
+            return grow();
+        }
+
+        auto turned = (MovingSpeed <= speed) && (TurnDegrees <= headingChange(_heading, heading));
+        _stationary = 0;
+        anchor(latitude, longitude, heading);
+        if (turned || (MovingSpeed > speed)) {
+            _interval = _minimum;
+        }
+        else {
+            auto interval = _distance * 1000.0f / speed;
+            _interval = (interval <= (float)_minimum) ? _minimum
+                      : ((interval >= (float)_maximum) ? _maximum : (unsigned int)interval);
+        }
+        return _interval;
+    }
+
+    /**
+     * @brief Get the number of consecutive stationary fixes
+     *
+     * @return unsigned int Stationary fixes, 0 while moving
+     */
+    unsigned int stationary() const {
+        return _stationary;
+    }
+
+    /**
+     * @brief Get the approximate distance between two positions
+     *
+     * Uses the equirectangular approximation, which is accurate to well under a percent over the distances between
+     * consecutive fixes.
+     *
+     * @return float Distance in meters
+     */
+    static float distanceMeters(int32_t latitude1, int32_t longitude1, int32_t latitude2, int32_t longitude2) {
+        constexpr float E7_TO_RADIANS {1.0e-7f * 3.14159265f / 180.0f};
+        constexpr float EARTH_RADIUS_METERS {6371000.0f};
+        auto deltaLongitude = (int64_t)longitude2 - longitude1;
+        if (1800000000 < deltaLongitude) {
+            deltaLongitude -= 3600000000;  // Shorter way across the antimeridian
+        }
+        else if (-1800000000 > deltaLongitude) {
+            deltaLongitude += 3600000000;
+        }
+        auto x = (float)deltaLongitude * E7_TO_RADIANS * cosf((float)(latitude1 / 2 + latitude2 / 2) * E7_TO_RADIANS);
+        auto y = (float)(latitude2 - latitude1) * E7_TO_RADIANS;
+        return sqrtf(x * x + y * y) * EARTH_RADIUS_METERS;
+    }
+
+    /**
+     * @brief Get the smallest angle between two headings
+     *
+     * @return float Angle in degrees, 0 to 180
+     */
+    static float headingChange(float from, float to) {
+        auto change = fmodf(fabsf(to - from), 360.0f);
+        return (180.0f < change) ? 360.0f - change : change;
+    }
+
+private:
+    unsigned int grow() {
+        _interval = (_interval >= _maximum / 2) ? _maximum : _interval * 2;
+        return _interval;
+    }
+
+    void anchor(int32_t latitude, int32_t longitude, float heading) {
+        _latitude = latitude;
+        _longitude = longitude;
+        _heading = heading;
+        _anchored = true;
+    }
+
+    unsigned int _minimum {};
+    unsigned int _maximum {};
+    float _distance {};
+    unsigned int _interval {};
+    bool _anchored {false};
+    int32_t _latitude {};
+    int32_t _longitude {};
+    float _heading {};
+    unsigned int _stationary {};
+};
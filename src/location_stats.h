@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Kinds of AT commands sent by the library
+ *
+ */
+enum class LocationAtCommand : uint8_t {
+    Start,                  /**< AT+QGPS=1 */
+    End,                    /**< AT+QGPSEND */
+    Poll,                   /**< AT+QGPSLOC, with or without the estimation error query */
+    EstimationError,        /**< AT+QGPSCFG="estimation_error" on its own */
+    Configure,              /**< Other AT+QGPSCFG settings */
+    Assistance,             /**< AT+QGPSXTRA, AT+QGPSXTRATIME and AT+QGPSXTRADATA */
+    Count,
+};
+
+constexpr size_t LocationLatencyBuckets {16};   /**< Bucket 0 is under 1 ms, bucket n from 2^(n-1) ms, the last is open ended */
+constexpr unsigned int LocationCmeCodes[] = {504, 505, 506, 516, 522, 549};  /**< CME errors counted individually */
+constexpr size_t LocationCmeCounters {sizeof(LocationCmeCodes) / sizeof(LocationCmeCodes[0]) + 1};  /**< Last counts other codes */
+
+/**
+ * @brief Counters of one kind of AT command
+ *
+ */
+struct LocationAtCommandStats {
+    uint32_t count;                             /**< Commands sent */
+    uint32_t errors;                            /**< Commands that failed or timed out */
+    uint32_t latency[LocationLatencyBuckets];   /**< Round trip histogram in log2 millisecond buckets */
+    uint32_t cme[LocationCmeCounters];          /**< CME errors, indexed as LocationCmeCodes */
+};
+
+/**
+ * @brief Counters of all AT commands sent by the library
+ *
+ */
+struct LocationAtStatistics {
+    LocationAtCommandStats command[(size_t)LocationAtCommand::Count];  /**< Indexed by LocationAtCommand */
+};
+
+/**
+ * @brief Lock-free AT command latency histograms and CME error counters
+ *
+ * Counters are updated with relaxed atomics so recording never blocks and never allocates.  A snapshot taken while
+ * commands are running may be off by the commands in flight.
+ *
+ */
+class LocationAtStats {
+public:
+    /**
+     * @brief Record the completion of a command
+     *
+     * @param command Kind of command
+     * @param latencyMs Round trip in milliseconds
+     * @param ok Command completed with OK
+     */
+    void record(LocationAtCommand command, uint32_t latencyMs, bool ok) {
+        auto& counters = _commands[(size_t)command];
+        counters.count.fetch_add(1, std::memory_order_relaxed);
+        if (!ok) {
+            counters.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        counters.latency[bucket(latencyMs)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record a CME error reported in response to a command
+     *
+     * @param command Kind of command
+     * @param code CME error code
+     */
+    void recordCme(LocationAtCommand command, unsigned int code) {
+        _commands[(size_t)command].cme[cmeIndex(code)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Copy all counters
+     *
+     * @param stats Counters
+     */
+    void snapshot(LocationAtStatistics& stats) const {
+        for (size_t i = 0; i < (size_t)LocationAtCommand::Count; i++) {
+            auto& counters = _commands[i];
+            auto& out = stats.command[i];
+            out.count = counters.count.load(std::memory_order_relaxed);
+            out.errors = counters.errors.load(std::memory_order_relaxed);
+            for (size_t j = 0; j < LocationLatencyBuckets; j++) {
+                out.latency[j] = counters.latency[j].load(std::memory_order_relaxed);
+            }
+            for (size_t j = 0; j < LocationCmeCounters; j++) {
+                out.cme[j] = counters.cme[j].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Clear all counters
+     *
+     */
+    void reset() {
+        for (auto& counters : _commands) {
+            counters.count.store(0, std::memory_order_relaxed);
+            counters.errors.store(0, std::memory_order_relaxed);
+            for (auto& bucket : counters.latency) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            for (auto& cme : counters.cme) {
+                cme.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Get the histogram bucket of a latency
+     *
+     * @param latencyMs Latency in milliseconds
+     * @return size_t Bucket index
+     */
+    static size_t bucket(uint32_t latencyMs) {
+        size_t index = 0;
+        while (latencyMs && (index < (LocationLatencyBuckets - 1))) {
+            latencyMs >>= 1;
+            index++;
+        }
+        return index;
+    }
+
+    /**
+     * @brief Get the counter index of a CME error code
+     *
+     * @param code CME error code
+     * @return size_t Index into LocationCmeCodes, or the last counter for other codes
+     */
+    static size_t cmeIndex(unsigned int code) {
+        for (size_t i = 0; i < LocationCmeCounters - 1; i++) {
+            if (LocationCmeCodes[i] == code) {
+                return i;
+            }
+        }
+        return LocationCmeCounters - 1;
+    }
+
+private:
+    struct Counters {
+        std::atomic<uint32_t> count {0};
+        std::atomic<uint32_t> errors {0};
+        std::atomic<uint32_t> latency[LocationLatencyBuckets] {};
+        std::atomic<uint32_t> cme[LocationCmeCounters] {};
+    };
+
+    Counters _commands[(size_t)LocationAtCommand::Count];
+};
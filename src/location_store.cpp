@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "location_store.h"
+
+uint8_t LocationStore::checksum(const uint8_t* data, size_t len) {
+    uint8_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum = (uint8_t)((sum << 1) | (sum >> 7)) ^ data[i];  // Rotate so that swapped bytes are detected
+    }
+    return ~sum;
+}
+
+void LocationStore::segmentPath(uint32_t segment, char* path) const {
+    snprintf(path, PathSize, "%s/f%08lx", _directory, (unsigned long)segment);
+}
+
+int LocationStore::begin(const char* directory, size_t slots) {
+    end();
+
+    if (!slots || (sizeof(_directory) <= strlen(directory)) || (mkdir(directory, 0777) && (EEXIST != errno))) {
+        return -1;
+    }
+    strcpy(_directory, directory);
+    _segments = (slots + SegmentRecords - 1) / SegmentRecords + 1;
+    _overwritten = 0;
+
+    // Earlier versions kept a single ring file rewritten in place
+    char path[PathSize];
+    snprintf(path, sizeof(path), "%s/fixes", _directory);
+    unlink(path);
+
+    if (scan()) {
+        end();
+        return -1;
+    }
+    return 0;
+}
+
+void LocationStore::end() {
+    if (0 > _fd) {
+        return;
+    }
+    sync();
+    commit();
+    close(_fd);
+    _fd = -1;
+    if (0 <= _readFd) {
+        close(_readFd);
+        _readFd = -1;
+    }
+}
+
+int LocationStore::openSegment(uint32_t segment, bool create) {
+    char path[PathSize];
+    segmentPath(segment, path);
+    auto fd = open(path, O_RDWR | O_APPEND | ((create) ? (O_CREAT | O_TRUNC) : 0), 0666);
+    if (0 > fd) {
+        return -1;
+    }
+    if (0 <= _fd) {
+        close(_fd);
+    }
+    _fd = fd;
+    _headSegment = segment;
+    return 0;
+}
+
+int LocationStore::deleteSegment(uint32_t segment) {
+    if ((0 <= _readFd) && (segment == _readSegment)) {
+        close(_readFd);
+        _readFd = -1;
+    }
+    char path[PathSize];
+    segmentPath(segment, path);
+    return (unlink(path) && (ENOENT != errno)) ? -1 : 0;
+}
+
+int LocationStore::readTail(uint32_t& tail) {
+    char path[PathSize];
+    snprintf(path, sizeof(path), "%s/tail", _directory);
+    auto fd = open(path, O_RDONLY);
+    if (0 > fd) {
+        return -1;
+    }
+    auto len = read(fd, &tail, sizeof(tail));
+    close(fd);
+    return ((ssize_t)sizeof(tail) == len) ? 0 : -1;
+}
+
+int LocationStore::scan() {
+    // Segment files are named after the first sequence number they hold divided by SegmentRecords
+    auto dir = opendir(_directory);
+    if (!dir) {
+        return -1;
+    }
+    bool found = false;
+    uint32_t first = 0;
+    uint32_t newest = 0;
+    while (auto entry = readdir(dir)) {
+        char* end = nullptr;
+        if (('f' != entry->d_name[0]) || (9 != strlen(entry->d_name))) {
+            continue;
+        }
+        auto segment = (uint32_t)strtoul(entry->d_name + 1, &end, 16);
+        if ('\0' != *end) {
+            continue;
+        }
+        if (!found || ((int32_t)(segment - newest) > 0)) {
+            newest = segment;
+        }
+        if (!found || ((int32_t)(segment - first) < 0)) {
+            first = segment;
+        }
+        found = true;
+    }
+    closedir(dir);
+
+    // Appends continue in the newest segment, after cutting off a record torn by a reset
+    if (openSegment(newest, !found)) {
+        return -1;
+    }
+    struct stat st = {};
+    if (fstat(_fd, &st)) {
+        return -1;
+    }
+    auto records = (size_t)st.st_size / SlotSize;
+    if ((records * SlotSize != (size_t)st.st_size) && ftruncate(_fd, (off_t)(records * SlotSize))) {
+        return -1;
+    }
+    _head = newest * (uint32_t)SegmentRecords + (uint32_t)records;
+    _unsynced = 0;
+
+    // Drop segments beyond the capacity, which happens when it was reduced
+    _first = first;
+    while ((size_t)(newest - _first) >= _segments) {
+        if (deleteSegment(_first)) {
+            return -1;
+        }
+        _first++;
+    }
+
+    uint32_t tail;
+    auto oldest = _first * (uint32_t)SegmentRecords;
+    if (readTail(tail) || ((int32_t)(tail - oldest) < 0) || ((int32_t)(_head - tail) < 0)) {
+        tail = oldest;
+    }
+    _tail = tail;
+    _committed = _tail;
+    return 0;
+}
+
+int LocationStore::append(const LocationPackedFix& fix) {
+    if (0 > _fd) {
+        return -1;
+    }
+
+    // Start the next segment once the current one is full, deleting the oldest when that exceeds the capacity
+    auto segment = _head / (uint32_t)SegmentRecords;
+    if (segment != _headSegment) {
+        if (sync() || openSegment(segment, true)) {
+            return -1;
+        }
+        while ((size_t)(segment - _first) >= _segments) {
+            if (deleteSegment(_first)) {
+                return -1;
+            }
+            _first++;
+        }
+        auto oldest = _first * (uint32_t)SegmentRecords;
+        if ((int32_t)(oldest - _tail) > 0) {
+            _overwritten += oldest - _tail;
+            _tail = oldest;
+        }
+    }
+
+    uint8_t slot[SlotSize];
+    memcpy(slot, &_head, SequenceSize);
+    LocationEncoder::pack(fix, slot + SequenceSize, LocationEncoder::PackedSize);
+    slot[SlotSize - 1] = checksum(slot, SlotSize - 1);
+    if ((ssize_t)sizeof(slot) != write(_fd, slot, sizeof(slot))) {
+        return -1;
+    }
+    _head++;
+
+    if (SyncInterval <= ++_unsynced) {
+        return sync();
+    }
+    return 0;
+}
+
+int LocationStore::sync() {
+    if (0 > _fd) {
+        return -1;
+    }
+    if (0 == _unsynced) {
+        return 0;
+    }
+    if (fsync(_fd)) {
+        return -1;
+    }
+    _unsynced = 0;
+    return 0;
+}
+
+int LocationStore::readRecord(uint32_t sequence, uint8_t* record) {
+    auto segment = sequence / (uint32_t)SegmentRecords;
+    auto fd = _fd;
+    if (segment != _headSegment) {
+        if ((0 > _readFd) || (segment != _readSegment)) {
+            if (0 <= _readFd) {
+                close(_readFd);
+            }
+            char path[PathSize];
+            segmentPath(segment, path);
+            _readFd = open(path, O_RDONLY);
+            if (0 > _readFd) {
+                return (ENOENT == errno) ? 1 : -1;
+            }
+            _readSegment = segment;
+        }
+        fd = _readFd;
+    }
+
+    uint8_t slot[SlotSize];
+    if (0 > lseek(fd, (off_t)((sequence % SegmentRecords) * SlotSize), SEEK_SET)) {
+        return -1;
+    }
+    auto len = read(fd, slot, sizeof(slot));
+    if (0 > len) {
+        return -1;
+    }
+
+    uint32_t stored;
+    memcpy(&stored, slot, SequenceSize);
+    if (((ssize_t)sizeof(slot) != len) || (stored != sequence) || (checksum(slot, SlotSize - 1) != slot[SlotSize - 1])) {
+        return 1;  // Missing, or corrupted since it was written
+    }
+    memcpy(record, slot + SequenceSize, LocationEncoder::PackedSize);
+    return 0;
+}
+
+int LocationStore::peek(LocationPackedFix& fix) {
+    while ((0 <= _fd) && pending()) {
+        uint8_t record[LocationEncoder::PackedSize];
+        auto ret = readRecord(_tail, record);
+        if (0 > ret) {
+            return -1;
+        }
+        if ((0 == ret) && !LocationEncoder::unpack(record, sizeof(record), fix)) {
+            return 0;
+        }
+        _tail++;  // Record was lost, skip it
+    }
+    return -1;
+}
+
+void LocationStore::pop() {
+    if (pending()) {
+        _tail++;
+    }
+}
+
+int LocationStore::commit() {
+    if (0 > _fd) {
+        return -1;
+    }
+    if (_committed == _tail) {
+        return 0;
+    }
+
+    char path[PathSize];
+    snprintf(path, sizeof(path), "%s/tail", _directory);
+    auto fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (0 > fd) {
+        return -1;
+    }
+    auto len = write(fd, &_tail, sizeof(_tail));
+    auto synced = fsync(fd);
+    close(fd);
+    if (((ssize_t)sizeof(_tail) != len) || synced) {
+        return -1;
+    }
+    _committed = _tail;
+    return 0;
+}
+
+int LocationStore::saveLast(const char* directory, const LocationPackedFix& fix) {
+    if (mkdir(directory, 0777) && (EEXIST != errno)) {
+        return -1;
+    }
+
+    uint8_t record[LastSize];
+    LocationEncoder::pack(fix, record, LocationEncoder::PackedSize);
+    record[LastSize - 1] = checksum(record, LastSize - 1);
+
+    char path[PathSize];
+    char temporary[PathSize];
+    snprintf(path, sizeof(path), "%s/last", directory);
+    snprintf(temporary, sizeof(temporary), "%s/last.tmp", directory);
+    auto fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (0 > fd) {
+        return -1;
+    }
+    auto len = write(fd, record, sizeof(record));
+    auto synced = fsync(fd);
+    close(fd);
+    if (((ssize_t)sizeof(record) != len) || synced || rename(temporary, path)) {
+        unlink(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+int LocationStore::loadLast(const char* directory, LocationPackedFix& fix) {
+    char path[PathSize];
+    snprintf(path, sizeof(path), "%s/last", directory);
+    auto fd = open(path, O_RDONLY);
+    if (0 > fd) {
+        return -1;
+    }
+    uint8_t record[LastSize];
+    auto len = read(fd, record, sizeof(record));
+    close(fd);
+    if (((ssize_t)sizeof(record) != len) || (checksum(record, LastSize - 1) != record[LastSize - 1])) {
+        return -1;
+    }
+    return LocationEncoder::unpack(record, LocationEncoder::PackedSize, fix);
+}
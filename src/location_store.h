@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "location_encode.h"
+
+/**
+ * @brief Persistent log of packed fixes kept on the filesystem while the device is offline
+ *
+ * Fixes are appended to segment files of SegmentRecords records, each record holding a sequence number, a packed fix
+ * and a checksum.  Records are only ever appended and a full segment is never written again, the next one is started
+ * and the oldest is deleted whole once the log holds more segments than needed for the requested capacity.  On
+ * littlefs, where rewriting part of a file copies its whole block, this keeps flash wear to one block program per
+ * block of fixes.  The open segment is synced every SyncInterval appends rather than on each one, so a reset loses at
+ * most the fixes appended since the last sync.
+ *
+ * The sequence number of the next fix to replay is kept in a separate tail file that is only rewritten by commit(), so
+ * a reset may replay fixes sent since the last commit but never skips ones that were not sent.  The log is rebuilt
+ * from the segment files when it is opened, and a record torn by a reset during its write is cut off.
+ *
+ * Only POSIX file functions are used.
+ *
+ */
+class LocationStore {
+public:
+    ~LocationStore() {
+        end();
+    }
+
+    /**
+     * @brief Open or create the log
+     *
+     * @param directory Directory holding the log, created if missing
+     * @param slots Number of fixes held at least, the oldest segments are deleted when it shrinks
+     * @retval 0 Success
+     * @retval -1 Filesystem error
+     */
+    int begin(const char* directory, size_t slots);
+
+    /**
+     * @brief Sync the open segment, commit the tail and close the log
+     *
+     */
+    void end();
+
+    /**
+     * @brief Indicate whether the log is open
+     *
+     * @return true Log is open
+     * @return false Log is closed
+     */
+    bool isOpen() const {
+        return (0 <= _fd);
+    }
+
+    /**
+     * @brief Append a fix, deleting the oldest segment when a new one is needed and the log is full
+     *
+     * @param fix Fix to append
+     * @retval 0 Success
+     * @retval -1 Filesystem error or log closed
+     */
+    int append(const LocationPackedFix& fix);
+
+    /**
+     * @brief Read the oldest fix not yet replayed
+     *
+     * @param fix Oldest fix
+     * @retval 0 Success
+     * @retval -1 No fixes pending or filesystem error
+     */
+    int peek(LocationPackedFix& fix);
+
+    /**
+     * @brief Mark the oldest fix as replayed
+     *
+     */
+    void pop();
+
+    /**
+     * @brief Persist the replay position
+     *
+     * @retval 0 Success
+     * @retval -1 Filesystem error or log closed
+     */
+    int commit();
+
+    /**
+     * @brief Write fixes appended since the last sync to flash
+     *
+     * @retval 0 Success
+     * @retval -1 Filesystem error or log closed
+     */
+    int sync();
+
+    /**
+     * @brief Get the number of fixes not yet replayed
+     *
+     * @return size_t Number of fixes
+     */
+    size_t pending() const {
+        return (size_t)(_head - _tail);
+    }
+
+    /**
+     * @brief Get the number of unreplayed fixes deleted because the log was full
+     *
+     * @return uint32_t Number of fixes
+     */
+    uint32_t overwritten() const {
+        return _overwritten;
+    }
+
+    /**
+     * @brief Replace the single fix kept in the last file of a directory
+     *
+     * The fix is written to a temporary file that is then renamed over the last file, so a reset never leaves a
+     * partly written fix.
+     *
+     * @param directory Directory holding the file, created if missing
+     * @param fix Fix to keep
+     * @retval 0 Success
+     * @retval -1 Filesystem error
+     */
+    static int saveLast(const char* directory, const LocationPackedFix& fix);
+
+    /**
+     * @brief Read the fix kept in the last file of a directory
+     *
+     * @param directory Directory holding the file
+     * @param fix Fix kept
+     * @retval 0 Success
+     * @retval -1 No fix kept, or it is corrupt
+     */
+    static int loadLast(const char* directory, LocationPackedFix& fix);
+
+    static constexpr size_t SegmentRecords {64};    /**< Fixes per segment file, 2816 bytes, within one flash block */
+    static constexpr unsigned int SyncInterval {8}; /**< Appends between syncs of the open segment */
+
+private:
+    static constexpr size_t SequenceSize {4};
+    static constexpr size_t SlotSize {SequenceSize + LocationEncoder::PackedSize + 1};  // Sequence, record, checksum
+    static constexpr size_t LastSize {LocationEncoder::PackedSize + 1};   // Record, checksum
+    static constexpr size_t DirectorySize {96};
+    static constexpr size_t PathSize {DirectorySize + 16};
+
+    static uint8_t checksum(const uint8_t* data, size_t len);
+    void segmentPath(uint32_t segment, char* path) const;
+    int scan();
+    int openSegment(uint32_t segment, bool create);
+    int deleteSegment(uint32_t segment);
+    int readTail(uint32_t& tail);
+    int readRecord(uint32_t sequence, uint8_t* record);
+
+    int _fd {-1};                   // Newest segment, open for appends
+    int _readFd {-1};               // Older segment being replayed
+    uint32_t _readSegment {};
+    uint32_t _headSegment {};
+    char _directory[DirectorySize] {};
+    size_t _segments {};            // Segments kept, including the one being appended to
+    uint32_t _first {};             // Oldest segment on the filesystem
+    uint32_t _head {};              // Sequence number of the next fix appended
+    uint32_t _tail {};              // Sequence number of the next fix replayed
+    uint32_t _committed {};         // Tail last written to the tail file
+    unsigned int _unsynced {};      // Appends since the last sync
+    uint32_t _overwritten {};
+};
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+/**
+ * @brief UTC calendar conversions that do not depend on the C library time zone
+ *
+ */
+class LocationTime {
+public:
+    /**
+     * @brief Number of days from 1970-01-01 to the given proleptic Gregorian date
+     *
+     * Uses the era based days-from-civil algorithm so that the conversion has no loops or tables.
+     *
+     * @param year Full year, for example 2024
+     * @param month Month, 1 to 12
+     * @param day Day of month, 1 to 31
+     * @return int32_t Days since the epoch, negative before 1970
+     */
+    static constexpr int32_t daysFromCivil(int32_t year, unsigned int month, unsigned int day) {
+        year -= (2 >= month) ? 1 : 0;
+        const int32_t era = ((0 <= year) ? year : year - 399) / 400;
+        const uint32_t yearOfEra = (uint32_t)(year - era * 400);                                // [0, 399]
+        const uint32_t dayOfYear = (153 * ((2 < month) ? month - 3 : month + 9) + 2) / 5 + day - 1;  // [0, 365]
+        const uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;   // [0, 146096]
+        return era * 146097 + (int32_t)dayOfEra - 719468;
+    }
+
+    /**
+     * @brief Convert a UTC date and time to seconds since the epoch
+     *
+     * @param year Full year, for example 2024
+     * @param month Month, 1 to 12
+     * @param day Day of month, 1 to 31
+     * @param hour Hour, 0 to 23
+     * @param minute Minute, 0 to 59
+     * @param second Second, 0 to 60
+     * @return time_t Seconds since 1970-01-01T00:00:00Z
+     */
+    static constexpr time_t epochFromUtc(int32_t year, unsigned int month, unsigned int day,
+                                         unsigned int hour, unsigned int minute, unsigned int second) {
+        return (time_t)daysFromCivil(year, month, day) * 86400 + (time_t)(hour * 3600 + minute * 60 + second);
+    }
+};
+
+static_assert(0 == LocationTime::daysFromCivil(1970, 1, 1), "Epoch must be day zero");
+static_assert(946684800 == LocationTime::epochFromUtc(2000, 1, 1, 0, 0, 0), "2000-01-01T00:00:00Z");
+static_assert(951782400 == LocationTime::epochFromUtc(2000, 2, 29, 0, 0, 0), "2000-02-29T00:00:00Z");
+static_assert(1709251199 == LocationTime::epochFromUtc(2024, 2, 29, 23, 59, 59), "2024-02-29T23:59:59Z");
+static_assert(4102444799 == LocationTime::epochFromUtc(2099, 12, 31, 23, 59, 59), "2099-12-31T23:59:59Z");
@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * @brief Host stand-in for the parts of Device OS used by the library
+ *
+ * Threads, queues, semaphores and mutexes are backed by the C++ standard library so that the acquisition loop runs
+ * unchanged on the host against a LocationSimulatedModem.  There is no cellular modem and no cloud connection, events
+ * are handed to the handler set with particle::host::onPublish().  Monotonic time can be sped up with
+ * particle::host::timeScale() or the PARTICLE_HOST_TIME_SCALE environment variable, so that simulated acquisitions do
+ * not take real time.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <mutex>
+
+#define PLATFORM_MSOM 35
+#define PLATFORM_ID PLATFORM_MSOM
+#define SYSTEM_VERSION_v582
+
+#define SYSTEM_MODE(mode)
+#define SYSTEM_THREAD(state)
+
+typedef uint32_t system_tick_t;
+typedef uint16_t pin_t;
+typedef int32_t time32_t;
+
+using std::min;
+using std::max;
+
+#if !defined(__APPLE__) && !(defined(__GLIBC__) && ((2 < __GLIBC__) || (38 <= __GLIBC_MINOR__)))
+size_t strlcpy(char* dest, const char* src, size_t size);
+#endif
+
+// System errors
+
+#define SYSTEM_ERROR_NONE 0
+#define SYSTEM_ERROR_BUSY -110
+#define SYSTEM_ERROR_NOT_SUPPORTED -120
+#define SYSTEM_ERROR_TIMEOUT -160
+#define SYSTEM_ERROR_INVALID_STATE -210
+#define SYSTEM_ERROR_NO_MEMORY -260
+#define SYSTEM_ERROR_INVALID_ARGUMENT -270
+
+// Pins
+
+#define PIN_INVALID (0xff)
+#define GNSS_ANT_PWR (27)
+#define INPUT (0)
+#define OUTPUT (1)
+#define LOW (0)
+#define HIGH (1)
+
+inline void pinMode(pin_t, int) {
+}
+
+inline void digitalWrite(pin_t, int) {
+}
+
+void delay(system_tick_t ms);
+
+#define waitFor(condition, timeoutMs) \
+    ({ \
+        auto _start = System.millis(); \
+        while (!condition() && ((System.millis() - _start) < (timeoutMs))) { \
+            delay(1); \
+        } \
+        condition(); \
+    })
+
+// Concurrency
+
+#define CONCURRENT_WAIT_FOREVER ((system_tick_t)-1)
+#define OS_THREAD_PRIORITY_DEFAULT (2)
+
+typedef struct HostQueue* os_queue_t;
+typedef struct HostSemaphore* os_semaphore_t;
+
+int os_queue_create(os_queue_t* queue, size_t itemSize, size_t length, void* reserved);
+int os_queue_put(os_queue_t queue, const void* item, system_tick_t delay, void* reserved);
+int os_queue_take(os_queue_t queue, void* item, system_tick_t delay, void* reserved);
+int os_queue_destroy(os_queue_t queue, void* reserved);
+int os_semaphore_create(os_semaphore_t* semaphore, unsigned max, unsigned initial);
+int os_semaphore_take(os_semaphore_t semaphore, system_tick_t timeout, bool reserved);
+int os_semaphore_give(os_semaphore_t semaphore, bool reserved);
+int os_semaphore_destroy(os_semaphore_t semaphore);
+
+class Thread {
+public:
+    Thread(const char* name, std::function<void()> function, int priority = OS_THREAD_PRIORITY_DEFAULT,
+           size_t stackSize = 0);
+
+    // Threads run until the process exits, there is no way to stop a std::thread from the outside
+    void cancel() {
+    }
+};
+
+class Mutex {
+public:
+    void lock() {
+        _mutex.lock();
+    }
+
+    bool trylock() {
+        return _mutex.try_lock();
+    }
+
+    void unlock() {
+        _mutex.unlock();
+    }
+
+private:
+    std::mutex _mutex;
+};
+
+namespace particle {
+
+template <typename F>
+class ScopeGuard {
+public:
+    explicit ScopeGuard(F&& func) : _func(std::move(func)) {
+    }
+
+    ~ScopeGuard() {
+        _func();
+    }
+
+private:
+    F _func;
+};
+
+} // namespace particle
+
+#define SCOPE_GUARD_CONCAT_(a, b) a##b
+#define SCOPE_GUARD_CONCAT(a, b) SCOPE_GUARD_CONCAT_(a, b)
+#define SCOPE_GUARD(func) \
+    auto SCOPE_GUARD_CONCAT(_scopeGuardFunc, __LINE__) = [&]() func; \
+    ::particle::ScopeGuard<decltype(SCOPE_GUARD_CONCAT(_scopeGuardFunc, __LINE__))> \
+        SCOPE_GUARD_CONCAT(_scopeGuard, __LINE__)(std::move(SCOPE_GUARD_CONCAT(_scopeGuardFunc, __LINE__)))
+
+// System and time
+
+class SystemClass {
+public:
+    uint64_t millis();
+    uint32_t ticks();
+
+    uint32_t ticksPerMicrosecond() {
+        return 1;
+    }
+};
+
+extern SystemClass System;
+
+class TimeClass {
+public:
+    time32_t now();
+    bool isValid();
+};
+
+extern TimeClass Time;
+
+// Logging
+
+#define LOG_LEVEL_ALL (1)
+#define LOG_LEVEL_TRACE (1)
+#define LOG_LEVEL_INFO (30)
+#define LOG_LEVEL_WARN (40)
+#define LOG_LEVEL_ERROR (50)
+#define LOG_LEVEL_NONE (70)
+
+class Logger {
+public:
+    explicit Logger(const char* name) : _name(name) {
+    }
+
+    void trace(const char* fmt, ...) const __attribute__((format(printf, 2, 3)));
+    void info(const char* fmt, ...) const __attribute__((format(printf, 2, 3)));
+    void warn(const char* fmt, ...) const __attribute__((format(printf, 2, 3)));
+    void error(const char* fmt, ...) const __attribute__((format(printf, 2, 3)));
+
+private:
+    void log(int level, const char* fmt, va_list args) const;
+
+    const char* _name;
+};
+
+extern const Logger Log;
+
+// Log output goes to stderr at or above the level of the most recent handler, and nowhere without one
+class SerialLogHandler {
+public:
+    explicit SerialLogHandler(int level = LOG_LEVEL_INFO);
+};
+
+// USB serial, reads come from particle::host::serialInput()
+
+class SerialClass {
+public:
+    bool isConnected() {
+        return true;
+    }
+
+    int available();
+    int read();
+};
+
+extern SerialClass Serial;
+
+// Cloud
+
+namespace particle {
+namespace protocol {
+
+constexpr size_t MAX_EVENT_NAME_LENGTH {64};
+constexpr size_t MAX_EVENT_DATA_LENGTH {1024};
+
+} // namespace protocol
+} // namespace particle
+
+class ParticleClass {
+public:
+    bool connected();
+    bool publish(const char* name, const char* data);
+};
+
+extern ParticleClass Particle;
+
+// Cellular, no modem is attached on the host
+
+enum {
+    TYPE_UNKNOWN = 0x000000,
+    TYPE_OK = 0x110000,
+    TYPE_ERROR = 0x120000,
+    TYPE_PLUS = 0x180000,
+};
+
+enum {
+    WAIT = -1,
+    RESP_OK = -2,
+    RESP_ERROR = -3,
+};
+
+#define DEV_QUECTEL_BG95_M5 (10)
+
+struct CellularDevice {
+    uint16_t size;
+    int dev;
+};
+
+inline int cellular_device_info(CellularDevice* device, void*) {
+    device->dev = 0;
+    return 0;
+}
+
+class CellularClass {
+public:
+    bool isOn() {
+        return false;
+    }
+
+    bool connecting() {
+        return false;
+    }
+
+    template <typename... Args>
+    int command(Args...) {
+        return RESP_ERROR;
+    }
+};
+
+extern CellularClass Cellular;
+
+namespace particle {
+class AtResponseReader;
+} // namespace particle
+
+using particle::AtResponseReader;
+
+typedef int (*hal_cellular_urc_callback_t)(AtResponseReader* reader, const char* prefix, void* data);
+
+inline int cellular_add_urc_handler(const char*, hal_cellular_urc_callback_t, void*) {
+    return SYSTEM_ERROR_NOT_SUPPORTED;
+}
+
+// JSON
+
+class JSONWriter {
+public:
+    virtual ~JSONWriter() = default;
+
+    JSONWriter& beginArray();
+    JSONWriter& endArray();
+    JSONWriter& beginObject();
+    JSONWriter& endObject();
+    JSONWriter& name(const char* name);
+    JSONWriter& value(bool val);
+    JSONWriter& value(int val);
+    JSONWriter& value(unsigned val);
+    JSONWriter& value(long val);
+    JSONWriter& value(unsigned long val);
+    JSONWriter& value(double val, int precision);
+    JSONWriter& value(double val);
+    JSONWriter& value(const char* val);
+    JSONWriter& nullValue();
+
+protected:
+    virtual void write(const char* data, size_t size) = 0;
+    void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+    enum State {
+        BEGIN,
+        ELEMENT,
+        NEXT,
+    };
+
+    void writeSeparator();
+    void write(char c) {
+        write(&c, 1);
+    }
+
+    State _state {BEGIN};
+};
+
+class JSONBufferWriter : public JSONWriter {
+public:
+    JSONBufferWriter(char* buffer, size_t size) : _buffer(buffer), _bufferSize(size) {
+    }
+
+    char* buffer() const {
+        return _buffer;
+    }
+
+    size_t bufferSize() const {
+        return _bufferSize;
+    }
+
+    size_t dataSize() const {
+        return _dataSize;
+    }
+
+protected:
+    void write(const char* data, size_t size) override;
+
+private:
+    char* _buffer;
+    size_t _bufferSize;
+    size_t _dataSize {};
+};
+
+// Host controls, not part of Device OS
+
+namespace particle {
+namespace host {
+
+/**
+ * @brief Speed up monotonic time and the timeouts of waits and delays
+ *
+ * @param factor Simulated milliseconds per real millisecond, 1 for real time
+ */
+void timeScale(unsigned int factor);
+
+/**
+ * @brief Set whether the cloud is connected, and so whether publishes succeed
+ *
+ * @param connected Cloud connection state
+ */
+void connected(bool connected);
+
+/**
+ * @brief Set the handler of published events
+ *
+ * @param handler Called with the name and data of each event, returns whether the publish succeeded
+ */
+void onPublish(std::function<bool(const char* name, const char* data)> handler);
+
+/**
+ * @brief Queue bytes to be read from Serial
+ *
+ * @param input Null terminated input
+ */
+void serialInput(const char* input);
+
+} // namespace host
+} // namespace particle
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Particle.h"
+
+void setup();
+void loop();
+
+// Runs a Device OS application on the host: setup() once, then loop() for as long as serial input remains, with the
+// arguments as the serial input
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        particle::host::serialInput(argv[i]);
+    }
+
+    setup();
+    while (Serial.available()) {
+        loop();
+    }
+    return 0;
+}
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Particle.h"
+
+SystemClass System;
+TimeClass Time;
+const Logger Log("app");
+SerialClass Serial;
+ParticleClass Particle;
+CellularClass Cellular;
+
+namespace {
+
+using HostClock = std::chrono::steady_clock;
+
+const HostClock::time_point hostStart = HostClock::now();
+
+unsigned int initialTimeScale() {
+    auto scale = getenv("PARTICLE_HOST_TIME_SCALE");
+    return (scale && (0 < atoi(scale))) ? (unsigned int)atoi(scale) : 1;
+}
+
+std::atomic<unsigned int> hostTimeScale {initialTimeScale()};
+std::atomic<int> hostLogLevel {LOG_LEVEL_NONE};
+std::atomic<bool> hostConnected {true};
+
+// Never destroyed, since the threads of the library keep running while the process exits
+std::mutex& hostMutex = *new std::mutex();
+std::function<bool(const char*, const char*)>& hostPublishHandler = *new std::function<bool(const char*, const char*)>();
+std::string& hostSerialInput = *new std::string();
+
+// Real time to wait for a timeout in scaled milliseconds, rounded up so that short waits still yield
+HostClock::duration realTimeout(system_tick_t ms) {
+    auto scale = hostTimeScale.load();
+    return std::chrono::microseconds(((uint64_t)ms * 1000 + scale - 1) / scale);
+}
+
+// Wait on a condition with a Device OS timeout, which is either forever or in scaled milliseconds
+template <typename P>
+bool waitUntil(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, system_tick_t ms, P predicate) {
+    if (CONCURRENT_WAIT_FOREVER == ms) {
+        cv.wait(lock, predicate);
+        return true;
+    }
+    return cv.wait_for(lock, realTimeout(ms), predicate);
+}
+
+} // anonymous namespace
+
+struct HostQueue {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    size_t itemSize;
+    size_t length;
+};
+
+struct HostSemaphore {
+    std::mutex mutex;
+    std::condition_variable changed;
+    unsigned count;
+    unsigned max;
+};
+
+#if !defined(__APPLE__) && !(defined(__GLIBC__) && ((2 < __GLIBC__) || (38 <= __GLIBC_MINOR__)))
+size_t strlcpy(char* dest, const char* src, size_t size) {
+    auto len = strlen(src);
+    if (size) {
+        auto copy = std::min(len, size - 1);
+        memcpy(dest, src, copy);
+        dest[copy] = '\0';
+    }
+    return len;
+}
+#endif
+
+void delay(system_tick_t ms) {
+    std::this_thread::sleep_for(realTimeout(ms));
+}
+
+int os_queue_create(os_queue_t* queue, size_t itemSize, size_t length, void*) {
+    *queue = new HostQueue();
+    (*queue)->itemSize = itemSize;
+    (*queue)->length = length;
+    return 0;
+}
+
+int os_queue_put(os_queue_t queue, const void* item, system_tick_t delay, void*) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!waitUntil(queue->changed, lock, delay, [queue]() {return queue->items.size() < queue->length;})) {
+        return -1;
+    }
+    auto bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    queue->changed.notify_all();
+    return 0;
+}
+
+int os_queue_take(os_queue_t queue, void* item, system_tick_t delay, void*) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!waitUntil(queue->changed, lock, delay, [queue]() {return !queue->items.empty();})) {
+        return -1;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return 0;
+}
+
+int os_queue_destroy(os_queue_t queue, void*) {
+    delete queue;
+    return 0;
+}
+
+int os_semaphore_create(os_semaphore_t* semaphore, unsigned max, unsigned initial) {
+    *semaphore = new HostSemaphore();
+    (*semaphore)->count = initial;
+    (*semaphore)->max = max;
+    return 0;
+}
+
+int os_semaphore_take(os_semaphore_t semaphore, system_tick_t timeout, bool) {
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    if (!waitUntil(semaphore->changed, lock, timeout, [semaphore]() {return 0 < semaphore->count;})) {
+        return -1;
+    }
+    semaphore->count--;
+    return 0;
+}
+
+int os_semaphore_give(os_semaphore_t semaphore, bool) {
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count >= semaphore->max) {
+        return -1;
+    }
+    semaphore->count++;
+    semaphore->changed.notify_all();
+    return 0;
+}
+
+int os_semaphore_destroy(os_semaphore_t semaphore) {
+    delete semaphore;
+    return 0;
+}
+
+Thread::Thread(const char*, std::function<void()> function, int, size_t) {
+    std::thread(function).detach();
+}
+
+uint64_t SystemClass::millis() {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(HostClock::now() - hostStart).count();
+    return (uint64_t)elapsed * hostTimeScale.load() / 1000;
+}
+
+uint32_t SystemClass::ticks() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(HostClock::now() - hostStart).count();
+}
+
+time32_t TimeClass::now() {
+    return (time32_t)time(nullptr);
+}
+
+bool TimeClass::isValid() {
+    return true;
+}
+
+void Logger::log(int level, const char* fmt, va_list args) const {
+    if (level < hostLogLevel.load()) {
+        return;
+    }
+
+    const char* name = (LOG_LEVEL_ERROR <= level) ? "ERROR" : (LOG_LEVEL_WARN <= level) ? "WARN"
+                                                  : (LOG_LEVEL_INFO <= level) ? "INFO" : "TRACE";
+    char line[512];
+    vsnprintf(line, sizeof(line), fmt, args);
+    std::lock_guard<std::mutex> lock(hostMutex);
+    fprintf(stderr, "%010llu [%s] %s: %s\n", (unsigned long long)System.millis(), _name, name, line);
+}
+
+void Logger::trace(const char* fmt, ...) const {
+    va_list args;
+    va_start(args, fmt);
+    log(LOG_LEVEL_TRACE, fmt, args);
+    va_end(args);
+}
+
+void Logger::info(const char* fmt, ...) const {
+    va_list args;
+    va_start(args, fmt);
+    log(LOG_LEVEL_INFO, fmt, args);
+    va_end(args);
+}
+
+void Logger::warn(const char* fmt, ...) const {
+    va_list args;
+    va_start(args, fmt);
+    log(LOG_LEVEL_WARN, fmt, args);
+    va_end(args);
+}
+
+void Logger::error(const char* fmt, ...) const {
+    va_list args;
+    va_start(args, fmt);
+    log(LOG_LEVEL_ERROR, fmt, args);
+    va_end(args);
+}
+
+SerialLogHandler::SerialLogHandler(int level) {
+    hostLogLevel.store(level);
+}
+
+int SerialClass::available() {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    return (int)hostSerialInput.size();
+}
+
+int SerialClass::read() {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    if (hostSerialInput.empty()) {
+        return -1;
+    }
+    auto c = (uint8_t)hostSerialInput.front();
+    hostSerialInput.erase(0, 1);
+    return c;
+}
+
+bool ParticleClass::connected() {
+    return hostConnected.load();
+}
+
+bool ParticleClass::publish(const char* name, const char* data) {
+    std::function<bool(const char*, const char*)> handler;
+    {
+        std::lock_guard<std::mutex> lock(hostMutex);
+        handler = hostPublishHandler;
+    }
+    return connected() && (!handler || handler(name, data));
+}
+
+void JSONWriter::writeSeparator() {
+    switch (_state) {
+        case NEXT:
+            write(',');
+            break;
+
+        case ELEMENT:
+            write(':');
+            break;
+
+        default:
+            break;
+    }
+}
+
+JSONWriter& JSONWriter::beginArray() {
+    writeSeparator();
+    write('[');
+    _state = BEGIN;
+    return *this;
+}
+
+JSONWriter& JSONWriter::endArray() {
+    write(']');
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::beginObject() {
+    writeSeparator();
+    write('{');
+    _state = BEGIN;
+    return *this;
+}
+
+JSONWriter& JSONWriter::endObject() {
+    write('}');
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::name(const char* name) {
+    writeSeparator();
+    write('"');
+    write(name, strlen(name));
+    write('"');
+    _state = ELEMENT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::value(bool val) {
+    writeSeparator();
+    if (val) {
+        write("true", 4);
+    }
+    else {
+        write("false", 5);
+    }
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::value(int val) {
+    writeSeparator();
+    printf("%d", val);
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::value(unsigned val) {
+    writeSeparator();
+    printf("%u", val);
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::value(long val) {
+    writeSeparator();
+    printf("%ld", val);
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::value(unsigned long val) {
+    writeSeparator();
+    printf("%lu", val);
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::value(double val, int precision) {
+    writeSeparator();
+    printf("%.*lf", precision, val);
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::value(double val) {
+    writeSeparator();
+    printf("%g", val);
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::value(const char* val) {
+    // Library strings never need escaping
+    writeSeparator();
+    write('"');
+    write(val, strlen(val));
+    write('"');
+    _state = NEXT;
+    return *this;
+}
+
+JSONWriter& JSONWriter::nullValue() {
+    writeSeparator();
+    write("null", 4);
+    _state = NEXT;
+    return *this;
+}
+
+void JSONWriter::printf(const char* fmt, ...) {
+    char buf[32];
+    va_list args;
+    va_start(args, fmt);
+    auto len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    write(buf, std::min((size_t)len, sizeof(buf) - 1));
+}
+
+void JSONBufferWriter::write(const char* data, size_t size) {
+    if (_dataSize < _bufferSize) {
+        memcpy(_buffer + _dataSize, data, std::min(size, _bufferSize - _dataSize));
+    }
+    _dataSize += size;
+}
+
+void particle::host::timeScale(unsigned int factor) {
+    hostTimeScale.store((factor) ? factor : 1);
+}
+
+void particle::host::connected(bool connected) {
+    hostConnected.store(connected);
+}
+
+void particle::host::onPublish(std::function<bool(const char* name, const char* data)> handler) {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    hostPublishHandler = handler;
+}
+
+void particle::host::serialInput(const char* input) {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    hostSerialInput += input;
+}
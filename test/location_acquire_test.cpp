@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "location_test.h"
+
+namespace {
+
+const char* const QLOC_FIX = "+QGPSLOC: 170411.000,37.78583,-122.40641,1.3,12.2,3,218.21,0.0,0.0,210524,09";
+const char* const EPE_FIX = R"(+QGPSCFG: "estimation_error",3.2,4.8,0.1,1.9)";
+
+} // anonymous namespace
+
+// Runs the acquisition loop of the library against the simulated BG95 on its own thread
+int main() {
+    LocationTestModem modem;
+    modem.play({
+        {0, nullptr, nullptr},
+        {3000, QLOC_FIX, EPE_FIX},
+    });
+
+    LocationConfiguration config;
+    LOCATION_CHECK(0 == modem.begin(config));
+
+    LocationPoint point {};
+    LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(point));
+    LOCATION_CHECK(0 != point.fix);
+    LOCATION_CHECK(1716311051 == point.epochTime);
+    LOCATION_CHECK(377858300 == LocationCoordinateTraits::toE7(point.latitude));
+    LOCATION_CHECK(-1224064100 == LocationCoordinateTraits::toE7(point.longitude));
+    LOCATION_CHECK(3.0f <= point.timeToFirstFix);
+    LOCATION_CHECK(!modem.modem().sessionActive());
+
+    LocationTiming timing {};
+    LOCATION_CHECK(Location.getLastTiming(timing));
+    LOCATION_CHECK(3 <= timing.polls);
+    LOCATION_CHECK(3000 <= timing.firstFixMs);
+
+    LOCATION_CHECK(Location.getLastLocation(point));
+    LOCATION_CHECK(0 != point.fix);
+
+    // Without power nothing answers and the acquisition gives up
+    modem.modem().power(false);
+    point = {};
+    LOCATION_CHECK(LocationResults::Unavailable == Location.getLocation(point));
+    modem.modem().power(true);
+
+    return locationTestResult();
+}
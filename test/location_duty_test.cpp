@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "location_scheduler.h"
+#include "location_test.h"
+
+namespace {
+
+// Parked, with the 0.4 km/h of noise a stationary receiver reports, then driving north at 41.2 km/h
+const char* const QLOC_PARKED = "+QGPSLOC: 170411.000,37.78583,-122.40641,1.3,12.2,3,218.21,0.4,0.2,210524,10";
+const char* const QLOC_PARKED_DRIFT = "+QGPSLOC: 170511.000,37.78584,-122.40642,1.1,12.6,3,218.21,0.4,0.2,210524,10";
+const char* const QLOC_NORTH = "+QGPSLOC: 170611.000,37.78883,-122.40641,0.9,12.2,3,000.00,41.2,22.2,210524,10";
+const char* const QLOC_NORTH_FURTHER = "+QGPSLOC: 170711.000,37.79183,-122.40641,0.9,12.2,3,000.00,41.2,22.2,210524,10";
+const char* const EPE = R"(+QGPSCFG: "estimation_error",3.2,4.8,0.1,1.9)";
+
+constexpr unsigned int MINIMUM_MS {30 * 1000};
+constexpr unsigned int MAXIMUM_MS {60 * 60 * 1000};
+constexpr unsigned int DISTANCE_METERS {500};
+
+// Acquire a polled fix from the simulated modem and schedule from it the way the duty cycle does
+unsigned int acquireNext(LocationTestModem& modem, LocationDutyScheduler& scheduler, const char* qloc) {
+    modem.play({
+        {0, qloc, EPE},
+    });
+
+    LocationPoint point {};
+    auto fixed = LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(point));
+    return scheduler.next(fixed, LocationCoordinateTraits::toE7(point.latitude),
+                          LocationCoordinateTraits::toE7(point.longitude),
+                          point.speed, point.heading, point.horizontalAccuracy);
+}
+
+} // anonymous namespace
+
+int main() {
+    LocationTestModem modem;
+    LocationConfiguration config;
+    LOCATION_CHECK(0 == modem.begin(config));
+
+    LocationDutyScheduler scheduler;
+    scheduler.begin(MINIMUM_MS, MAXIMUM_MS, DISTANCE_METERS);
+
+    // Parked fixes back off, the reported speed is well under walking pace once in meters per second
+    LOCATION_CHECK(MINIMUM_MS == acquireNext(modem, scheduler, QLOC_PARKED));
+    LOCATION_CHECK(2 * MINIMUM_MS == acquireNext(modem, scheduler, QLOC_PARKED_DRIFT));
+    LOCATION_CHECK(4 * MINIMUM_MS == acquireNext(modem, scheduler, QLOC_PARKED));
+    LOCATION_CHECK(2 == scheduler.stationary());
+
+    // Driving off turns away from the parked heading, then the interval covers the distance at 11.44 m/s
+    LOCATION_CHECK(MINIMUM_MS == acquireNext(modem, scheduler, QLOC_NORTH));
+    LOCATION_CHECK(0 == scheduler.stationary());
+    auto interval = acquireNext(modem, scheduler, QLOC_NORTH_FURTHER);
+    LOCATION_CHECK((43600 < interval) && (43800 > interval));
+
+    return locationTestResult();
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+
+#include "location_encode.h"
+#include "location_test.h"
+
+namespace {
+
+// Reference points and output of the encoded polyline algorithm format documentation
+struct TrackPoint {
+    int32_t latitude;
+    int32_t longitude;
+    uint32_t time;
+};
+
+const TrackPoint POLYLINE_POINTS[] = {
+    {385000000, -1202000000, 0},
+    {407000000, -1209500000, 0},
+    {432520000, -1264530000, 0},
+};
+const char* const POLYLINE = "_p~iF~ps|U_ulLnnqC_mqNvxq`@";
+
+// A dense track in both hemispheres, crossing the equator and the antimeridian at full precision
+const TrackPoint TRACK_POINTS[] = {
+    {-338688200, 1512092900, 1717201980},
+    {-338688123, 1512093011, 1717201981},
+    {-338687001, 1512091234, 1717201983},
+    {1, 1799999999, 1717201990},
+    {-1, -1799999999, 1717201991},
+    {899999999, -1, 1717202991},
+};
+
+// Fixes of a batch, moving back south west, descending and slowing down so that most deltas are negative
+LocationPackedFix batchFix(size_t i) {
+    LocationPackedFix fix {};
+    fix.locked = true;
+    fix.epochTime = 1717201980 + i;
+    fix.latitude = -338688200 - (int32_t)(i * 37);
+    fix.longitude = 1512092900 - (int32_t)(i * 53);
+    fix.altitude = 38400 - (int32_t)(i * 250);
+    fix.heading = (uint16_t)((i % 2) ? 35900 : 100);
+    fix.speed = (uint16_t)(1144 - i * 10);
+    fix.horizontalDop = (uint16_t)(9 + i % 3);
+    fix.horizontalAccuracy = (uint16_t)(320 - i * 7);
+    fix.verticalAccuracy = (uint16_t)(480 + i);
+    fix.satsInUse = (uint8_t)(10 - i % 4);
+    return fix;
+}
+
+bool sameFix(const LocationPackedFix& a, const LocationPackedFix& b) {
+    return (a.locked == b.locked) && (a.epochTime == b.epochTime) && (a.latitude == b.latitude) &&
+           (a.longitude == b.longitude) && (a.altitude == b.altitude) && (a.heading == b.heading) &&
+           (a.speed == b.speed) && (a.horizontalDop == b.horizontalDop) &&
+           (a.horizontalAccuracy == b.horizontalAccuracy) && (a.verticalAccuracy == b.verticalAccuracy) &&
+           (a.satsInUse == b.satsInUse);
+}
+
+bool checkTrack(unsigned int precision, LocationTrackFormat format, bool time) {
+    uint8_t buffer[128];
+    LocationTrackEncoder encoder;
+    encoder.begin(buffer, sizeof(buffer), precision, format, time);
+    for (auto& point : TRACK_POINTS) {
+        LOCATION_CHECK(encoder.add(point.latitude, point.longitude, point.time));
+    }
+    LOCATION_CHECK((sizeof(TRACK_POINTS) / sizeof(TRACK_POINTS[0])) == encoder.count());
+
+    LocationTrackDecoder decoder;
+    decoder.begin(encoder.data(), encoder.size(), precision, format, time);
+    int32_t scale = 1;
+    for (auto i = precision; i < 7; i++) {
+        scale *= 10;
+    }
+    auto ok = true;
+    for (auto& point : TRACK_POINTS) {
+        int32_t latitude;
+        int32_t longitude;
+        uint32_t timestamp;
+        ok &= LOCATION_CHECK(decoder.next(latitude, longitude, timestamp));
+        ok &= LOCATION_CHECK(LocationTrackEncoder::quantize(point.latitude, precision) * scale == latitude);
+        ok &= LOCATION_CHECK(LocationTrackEncoder::quantize(point.longitude, precision) * scale == longitude);
+        ok &= LOCATION_CHECK(((time) ? point.time : 0) == timestamp);
+    }
+    int32_t latitude;
+    int32_t longitude;
+    uint32_t timestamp;
+    ok &= LOCATION_CHECK(!decoder.next(latitude, longitude, timestamp) && !decoder.error());
+
+    // Cutting the last value short is reported as an error rather than a point
+    decoder.begin(encoder.data(), encoder.size() - 1, precision, format, time);
+    for (size_t i = 0; i + 1 < sizeof(TRACK_POINTS) / sizeof(TRACK_POINTS[0]); i++) {
+        ok &= LOCATION_CHECK(decoder.next(latitude, longitude, timestamp));
+    }
+    ok &= LOCATION_CHECK(!decoder.next(latitude, longitude, timestamp) && decoder.error());
+
+    if (!ok) {
+        fprintf(stderr, "track precision %u, %s format, %s time\n", precision,
+                (LocationTrackFormat::Text == format) ? "text" : "binary", (time) ? "with" : "without");
+    }
+    return ok;
+}
+
+} // anonymous namespace
+
+int main() {
+    // Text format with a precision of 5 is the encoded polyline algorithm format
+    uint8_t buffer[64];
+    LocationTrackEncoder encoder;
+    encoder.begin(buffer, sizeof(buffer), 5, LocationTrackFormat::Text);
+    for (auto& point : POLYLINE_POINTS) {
+        LOCATION_CHECK(encoder.add(point.latitude, point.longitude));
+    }
+    LOCATION_CHECK(strlen(POLYLINE) == encoder.size());
+    LOCATION_CHECK(0 == strcmp(POLYLINE, (const char*)encoder.data()));
+
+    LocationTrackDecoder decoder;
+    decoder.begin((const uint8_t*)POLYLINE, strlen(POLYLINE), 5, LocationTrackFormat::Text);
+    for (auto& point : POLYLINE_POINTS) {
+        int32_t latitude;
+        int32_t longitude;
+        uint32_t time;
+        LOCATION_CHECK(decoder.next(latitude, longitude, time));
+        LOCATION_CHECK((point.latitude == latitude) && (point.longitude == longitude) && (0 == time));
+    }
+
+    // A point that does not fit, terminator included, is refused and leaves the track intact
+    encoder.begin(buffer, strlen(POLYLINE) + 1, 5, LocationTrackFormat::Text);
+    for (auto& point : POLYLINE_POINTS) {
+        LOCATION_CHECK(encoder.add(point.latitude, point.longitude));
+    }
+    LOCATION_CHECK(!encoder.add(POLYLINE_POINTS[0].latitude, POLYLINE_POINTS[0].longitude));
+    LOCATION_CHECK((3 == encoder.count()) && (0 == strcmp(POLYLINE, (const char*)encoder.data())));
+
+    // Both formats round trip at the lowest, default and full precision, with and without time
+    for (auto format : {LocationTrackFormat::Binary, LocationTrackFormat::Text}) {
+        for (auto precision : {1u, 5u, 7u}) {
+            checkTrack(precision, format, false);
+            checkTrack(precision, format, true);
+        }
+    }
+
+    // Batches start with the version and count, and decode to the fixes added whatever the direction of each delta
+    constexpr size_t BATCH_FIXES {12};
+    uint8_t batch[256];
+    LocationBatchEncoder batchEncoder;
+    batchEncoder.begin(batch, sizeof(batch));
+    LOCATION_CHECK(0 == batchEncoder.size());
+    for (size_t i = 0; i < BATCH_FIXES; i++) {
+        LOCATION_CHECK(batchEncoder.add(batchFix(i)));
+    }
+    LOCATION_CHECK(BATCH_FIXES == batchEncoder.count());
+    LOCATION_CHECK(LocationBatchEncoder::BatchVersion == batch[0]);
+    LOCATION_CHECK(BATCH_FIXES == batch[1]);
+
+    LocationPackedFix fixes[BATCH_FIXES] {};
+    LOCATION_CHECK((int)BATCH_FIXES == LocationBatchEncoder::decode(batchEncoder.data(), batchEncoder.size(), fixes,
+                                                                   BATCH_FIXES));
+    for (size_t i = 0; i < BATCH_FIXES; i++) {
+        LOCATION_CHECK(sameFix(batchFix(i), fixes[i]));
+    }
+    size_t decoded = 0;
+    LOCATION_CHECK((int)BATCH_FIXES == LocationBatchEncoder::decode(batchEncoder.data(), batchEncoder.size(),
+        [](const LocationPackedFix& fix, void* param) {
+            auto& index = *static_cast<size_t*>(param);
+            LOCATION_CHECK(sameFix(batchFix(index++), fix));
+        }, &decoded));
+    LOCATION_CHECK(BATCH_FIXES == decoded);
+
+    // Malformed batches are refused
+    LOCATION_CHECK(0 > LocationBatchEncoder::decode(batchEncoder.data(), batchEncoder.size(), fixes, BATCH_FIXES - 1));
+    LOCATION_CHECK(0 > LocationBatchEncoder::decode(batchEncoder.data(), batchEncoder.size() - 1, fixes, BATCH_FIXES));
+    batch[0] = LocationBatchEncoder::BatchVersion - 1;
+    LOCATION_CHECK(0 > LocationBatchEncoder::decode(batchEncoder.data(), batchEncoder.size(), fixes, BATCH_FIXES));
+
+    // A full batch refuses the next fix and keeps the ones it holds
+    batchEncoder.begin(batch, 64);
+    size_t added = 0;
+    while (batchEncoder.add(batchFix(added))) {
+        added++;
+    }
+    LOCATION_CHECK((0 < added) && (BATCH_FIXES > added) && (added == batchEncoder.count()));
+    LOCATION_CHECK(64 >= batchEncoder.size());
+    LOCATION_CHECK((int)added == LocationBatchEncoder::decode(batchEncoder.data(), batchEncoder.size(), fixes,
+                                                             BATCH_FIXES));
+    LOCATION_CHECK(sameFix(batchFix(added - 1), fixes[added - 1]));
+
+    // So does one holding the most fixes the count byte allows
+    static uint8_t large[LocationBatchEncoder::HeaderSize + (LocationBatchEncoder::MaxFixes + 1) *
+                         LocationBatchEncoder::MaxFixSize];
+    batchEncoder.begin(large, sizeof(large));
+    for (size_t i = 0; i < LocationBatchEncoder::MaxFixes; i++) {
+        LOCATION_CHECK(batchEncoder.add(batchFix(i % BATCH_FIXES)));
+    }
+    LOCATION_CHECK(!batchEncoder.add(batchFix(0)));
+    LOCATION_CHECK(LocationBatchEncoder::MaxFixes == large[1]);
+
+    return locationTestResult();
+}
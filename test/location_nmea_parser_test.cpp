@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "location_nmea.h"
+#include "location_test.h"
+
+namespace {
+
+const char* const GGA_NE = "$GPGGA,123519.000,4807.0380,N,01131.0000,E,1,08,0.9,545.4,M,46.9,M,,*59\r\n";
+const char* const GGA_SW = "$GPGGA,123520.000,3352.1292,S,15112.5574,W,1,08,0.9,545.4,M,46.9,M,,*54\r\n";
+const char* const RMC_SW = "$GPRMC,123520.000,A,3352.1292,S,15112.5574,W,0.000,0.00,010624,,,A*5D\r\n";
+const char* const GSA = "$GPGSA,A,3,04,05,09,12,,,,,,,,,2.5,1.3,2.1*3F\r\n";
+const char* const GSV_1 = "$GPGSV,2,1,05,04,40,083,46,05,17,308,41,09,07,344,,12,77,123,42*73\r\n";
+const char* const GSV_2 = "$GPGSV,2,2,05,24,-3,021,*57\r\n";
+const char* const GLGSV = "$GLGSV,1,1,02,65,20,100,30,66,10,200,*67\r\n";
+const char* const GGA_NEXT = "$GPGGA,123521.000,4000.0000,N,07400.0000,W,1,09,1.1,10.0,M,46.9,M,,*7C\r\n";
+
+// The same GGA sentence with a corrupted checksum, cut short before the checksum, and padded past the length limit
+// with commas that leave the checksum unchanged
+const char* const GGA_BAD_CHECKSUM = "$GPGGA,123521.000,4000.0000,N,07400.0000,W,1,09,1.1,10.0,M,46.9,M,,*7D\r\n";
+const char* const GGA_TRUNCATED = "$GPGGA,123521.000,4000.0000,N,07400.0000,W,1,09,1.1,10";
+const char* const GGA_NO_CHECKSUM = "$GPGGA,123521.000,4000.0000,N,07400.0000,W,1,09,1.1,10.0,M,46.9,M,,\r\n";
+const char* const GGA_OVERLONG =
+    "$GPGGA,123519.000,4807.0380,N,01131.0000,E,1,08,0.9,545.4,M,46.9,M,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,*59\r\n";
+
+constexpr time_t EPOCH_123520 {1717245320};  // 2024-06-01 12:35:20 UTC
+
+bool closeTo(float value, float expected) {
+    return 0.001f > std::fabs(value - expected);
+}
+
+int feed(LocationNmeaParser& parser, const char* sentence) {
+    return parser.feed(sentence, strlen(sentence));
+}
+
+const LocationSatellite* findSatellite(const LocationSatellites& satellites, LocationGnssSystem system, uint8_t prn) {
+    for (unsigned int i = 0; i < satellites.count; i++) {
+        if ((system == satellites.satellite[i].system) && (prn == satellites.satellite[i].prn)) {
+            return &satellites.satellite[i];
+        }
+    }
+    return nullptr;
+}
+
+} // anonymous namespace
+
+int main() {
+    LocationNmeaParser parser;
+
+    // GGA gives position, satellites, HDOP and altitude, ddmm.mmmm is converted exactly to 1e-7 degrees
+    LOCATION_CHECK(LOCATION_NMEA_GGA == feed(parser, GGA_NE));
+    LOCATION_CHECK(2 == parser.point().fix);
+    LOCATION_CHECK(481173000 == LocationCoordinateTraits::toE7(parser.point().latitude));
+    LOCATION_CHECK(115166667 == LocationCoordinateTraits::toE7(parser.point().longitude));
+    LOCATION_CHECK(8 == parser.point().satsInUse);
+    LOCATION_CHECK(closeTo(parser.point().horizontalDop, 0.9f));
+    LOCATION_CHECK(closeTo(parser.point().altitude, 545.4f));
+    LOCATION_CHECK(0 == parser.point().epochTime);  // No date before the first RMC sentence
+
+    // South and west hemispheres are negative
+    LOCATION_CHECK(LOCATION_NMEA_GGA == feed(parser, GGA_SW));
+    LOCATION_CHECK(-338688200 == LocationCoordinateTraits::toE7(parser.point().latitude));
+    LOCATION_CHECK(-1512092900 == LocationCoordinateTraits::toE7(parser.point().longitude));
+    LOCATION_CHECK(LOCATION_NMEA_RMC == feed(parser, RMC_SW));
+    LOCATION_CHECK(EPOCH_123520 == parser.point().epochTime);
+    LOCATION_CHECK(-338688200 == LocationCoordinateTraits::toE7(parser.point().latitude));
+    LOCATION_CHECK(-1512092900 == LocationCoordinateTraits::toE7(parser.point().longitude));
+
+    // GSA gives the fix type, dilutions and satellites in use
+    LOCATION_CHECK(LOCATION_NMEA_GSA == feed(parser, GSA));
+    LOCATION_CHECK(3 == parser.point().fix);
+    LOCATION_CHECK(closeTo(parser.point().horizontalDop, 1.3f));
+    LOCATION_CHECK(closeTo(parser.point().verticalDop, 2.1f));
+
+    // GSV groups replace the satellites of their own system only
+    LOCATION_CHECK(LOCATION_NMEA_GSV == feed(parser, GLGSV));
+    LOCATION_CHECK(LOCATION_NMEA_GSV == (feed(parser, GSV_1) | feed(parser, GSV_2)));
+    auto& satellites = parser.satellites();
+    LOCATION_CHECK(7 == satellites.inView);
+    LOCATION_CHECK(7 == satellites.count);
+    auto satellite = findSatellite(satellites, LocationGnssSystem::Gps, 4);
+    LOCATION_CHECK(satellite && (40 == satellite->elevation) && (83 == satellite->azimuth) && (46 == satellite->snr) &&
+                   satellite->used);
+    satellite = findSatellite(satellites, LocationGnssSystem::Gps, 9);
+    LOCATION_CHECK(satellite && (0 == satellite->snr) && satellite->used);
+    satellite = findSatellite(satellites, LocationGnssSystem::Gps, 24);
+    LOCATION_CHECK(satellite && (-3 == satellite->elevation) && (21 == satellite->azimuth) && !satellite->used);
+    satellite = findSatellite(satellites, LocationGnssSystem::Glonass, 66);
+    LOCATION_CHECK(satellite && (200 == satellite->azimuth) && !satellite->used);
+    LOCATION_CHECK(LOCATION_NMEA_GSV == feed(parser, GSV_1));
+    LOCATION_CHECK(6 == satellites.count);
+
+    // Sentences that fail to validate change nothing, even though their fields were decoded on the way
+    auto errors = parser.errors();
+    parser.clearUpdated();
+    LOCATION_CHECK(LOCATION_NMEA_NONE == feed(parser, GGA_BAD_CHECKSUM));
+    LOCATION_CHECK(LOCATION_NMEA_NONE == feed(parser, GGA_TRUNCATED));
+    LOCATION_CHECK(LOCATION_NMEA_NONE == feed(parser, GGA_NO_CHECKSUM));
+    LOCATION_CHECK(LOCATION_NMEA_NONE == feed(parser, GGA_OVERLONG));
+    LOCATION_CHECK(errors + 4 == parser.errors());
+    LOCATION_CHECK(LOCATION_NMEA_NONE == parser.updated());
+    LOCATION_CHECK(-338688200 == LocationCoordinateTraits::toE7(parser.point().latitude));
+    LOCATION_CHECK(-1512092900 == LocationCoordinateTraits::toE7(parser.point().longitude));
+    LOCATION_CHECK(8 == parser.point().satsInUse);
+    LOCATION_CHECK(closeTo(parser.point().altitude, 545.4f));
+    LOCATION_CHECK(EPOCH_123520 == parser.point().epochTime);
+
+    // A sentence dropped part way is counted when the next one starts, which still parses
+    LOCATION_CHECK(LOCATION_NMEA_NONE == feed(parser, GGA_TRUNCATED));
+    LOCATION_CHECK(LOCATION_NMEA_GGA == feed(parser, GGA_NEXT));
+    LOCATION_CHECK(errors + 5 == parser.errors());
+    LOCATION_CHECK(400000000 == LocationCoordinateTraits::toE7(parser.point().latitude));
+    LOCATION_CHECK(-740000000 == LocationCoordinateTraits::toE7(parser.point().longitude));
+    LOCATION_CHECK(9 == parser.point().satsInUse);
+    LOCATION_CHECK(EPOCH_123520 + 1 == parser.point().epochTime);
+
+    return locationTestResult();
+}
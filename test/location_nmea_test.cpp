@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "location_nmea.h"
+#include "location_test.h"
+
+namespace {
+
+// The same fix at 41.2 km/h, or 22.246 knots, as pushed NMEA sentences and as a polled AT+QGPSLOC response
+const char* const NMEA_RMC = "$GPRMC,003259.000,A,3352.1292,S,15112.5574,E,22.246,95.78,010624,,,A*46\r\n";
+const char* const NMEA_VTG = "$GPVTG,95.78,T,,M,22.246,N,41.200,K,A*09\r\n";
+const char* const QLOC = "+QGPSLOC: 003259.000,-33.86882,151.20929,0.9,38.4,3,095.47,41.2,22.2,010624,10";
+const char* const EPE = R"(+QGPSCFG: "estimation_error",3.2,4.8,0.1,1.9)";
+
+// Two seconds of receiver output in the order the BG95 sends it
+const char* const NMEA_EPOCH_1 =
+    "$GPRMC,003300.000,A,3352.1292,S,15112.5574,E,22.246,95.78,010624,,,A*4B\r\n"
+    "$GPGGA,003300.000,3352.1292,S,15112.5574,E,1,10,0.9,38.4,M,22.0,M,,*7C\r\n"
+    "$GPGSA,A,3,02,05,12,13,15,18,20,24,25,29,,,1.6,0.9,1.3*3D\r\n"
+    "$GPVTG,95.78,T,,M,22.246,N,41.200,K,A*09\r\n";
+const char* const NMEA_EPOCH_2 =
+    "$GPRMC,003301.000,A,3352.1292,S,15112.5574,E,22.246,95.78,010624,,,A*4A\r\n"
+    "$GPGGA,003301.000,3352.1292,S,15112.5574,E,1,10,0.9,38.4,M,22.0,M,,*7D\r\n"
+    "$GPGSA,A,3,02,05,12,13,15,18,20,24,25,29,,,1.6,0.9,1.3*3D\r\n"
+    "$GPVTG,95.78,T,,M,22.246,N,41.200,K,A*09\r\n";
+
+constexpr float SPEED_MPS {41.2f / 3.6f};
+constexpr float SPEED_TOLERANCE_MPS {0.01f};
+constexpr float FALLBACK_SECONDS {10.0f};
+
+bool closeTo(float value, float expected) {
+    return SPEED_TOLERANCE_MPS > std::fabs(value - expected);
+}
+
+} // anonymous namespace
+
+int main() {
+    // Pushed sentences report speed in meters per second
+    LocationNmeaParser parser;
+    LOCATION_CHECK(LOCATION_NMEA_RMC & parser.feed(NMEA_RMC, strlen(NMEA_RMC)));
+    LOCATION_CHECK(LOCATION_NMEA_VTG & parser.feed(NMEA_VTG, strlen(NMEA_VTG)));
+    LOCATION_CHECK(closeTo(parser.point().speed, SPEED_MPS));
+
+    {
+        LocationTestModem modem;
+        modem.play({
+            {0, QLOC, EPE},
+        });
+
+        // Polled fixes report the same speed in the same unit
+        LocationConfiguration config;
+        LOCATION_CHECK(0 == modem.begin(config));
+        LocationPoint polled {};
+        LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(polled));
+        LOCATION_CHECK(closeTo(polled.speed, parser.point().speed));
+
+        // Like the BG95 the simulator sends no NMEA output to the AT port, so the first push session falls back to
+        // polling after waiting for it, and later sessions with the same modem poll from the start
+        config.acquisitionMode(LocationAcquisitionMode::Push);
+        LOCATION_CHECK(0 == modem.begin(config));
+        LocationPoint pushed {};
+        LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(pushed));
+        LOCATION_CHECK(FALLBACK_SECONDS <= pushed.timeToFirstFix);
+        LOCATION_CHECK(closeTo(pushed.speed, SPEED_MPS));
+
+        LOCATION_CHECK(0 == modem.begin(config));
+        pushed = {};
+        LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(pushed));
+        LOCATION_CHECK(FALLBACK_SECONDS > pushed.timeToFirstFix);
+    }
+
+    {
+        // A modem that delivers NMEA output as URCs, polling would never get a fix from it
+        LocationTestModem modem;
+        modem.play({
+            {0, nullptr, nullptr},
+            {2000, nullptr, EPE, NMEA_EPOCH_1},
+            {3000, nullptr, EPE, NMEA_EPOCH_2},
+        });
+        modem.nmeaUrcs();
+
+        LocationConfiguration config;
+        config.acquisitionMode(LocationAcquisitionMode::Push);
+        LOCATION_CHECK(0 == modem.begin(config));
+        LocationPoint pushed {};
+        LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(pushed));
+        LOCATION_CHECK(0 != pushed.fix);
+        LOCATION_CHECK(1717201981 == pushed.epochTime);
+        LOCATION_CHECK(-338688200 == LocationCoordinateTraits::toE7(pushed.latitude));
+        LOCATION_CHECK(1512092900 == LocationCoordinateTraits::toE7(pushed.longitude));
+        LOCATION_CHECK(closeTo(pushed.speed, SPEED_MPS));
+        LOCATION_CHECK(3.2f == pushed.horizontalAccuracy);
+        LOCATION_CHECK((2.0f <= pushed.timeToFirstFix) && (FALLBACK_SECONDS > pushed.timeToFirstFix));
+        LOCATION_CHECK(!modem.modem().sessionActive());
+    }
+
+    // Application builds lack the AT parser header of Device OS, so the cellular modem refuses URC handlers and push
+    // sessions poll from the start
+    LOCATION_CHECK(0 != Location.cellularModem().addUrcHandler("$G", [](const char*, const char*, int, void*) {},
+                                                               nullptr));
+
+    return locationTestResult();
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "location_test.h"
+
+namespace {
+
+const char* const QLOC_FIX = "+QGPSLOC: 170411.000,37.78583,-122.40641,1.3,12.2,3,218.21,0.0,0.0,210524,09";
+const char* const EPE_FIX = R"(+QGPSCFG: "estimation_error",3.2,4.8,0.1,1.9)";
+
+} // anonymous namespace
+
+// Checks that assignment, which SomLocation::begin() uses to keep the configuration, copies every setting
+int main() {
+    LocationConfiguration source;
+    source.constellations(LOCATION_CONST_GPS_BEIDOU)
+          .enableAntennaPower(GNSS_ANT_PWR)
+          .hdopThreshold(5)
+          .haccThreshold(2.5f)
+          .maximumFixTime(45)
+          .acquisitionMode(LocationAcquisitionMode::Push)
+          .publishEncoding(LocationPublishEncoding::Packed)
+          .publishBatch(8, 60)
+          .storeOffline(64, 2000)
+          .assistance(true, 90)
+          .reference(true)
+          .startPolicy(LocationStartType::Warm, {3, 500, 60})
+          .rfSharing(2000, 3000, 4000)
+          .dutyCycle(60, 600, 250)
+          .pollInterval(500, 4000)
+          .pollBackoff(1.5f);
+
+    LocationConfiguration copy;
+    copy = source;
+    LOCATION_CHECK(LOCATION_CONST_GPS_BEIDOU == copy.constellations());
+    LOCATION_CHECK(GNSS_ANT_PWR == copy.enableAntennaPower());
+    LOCATION_CHECK(5 == copy.hdopThreshold());
+    LOCATION_CHECK(2.5f == copy.haccThreshold());
+    LOCATION_CHECK(45 == copy.maximumFixTime());
+    LOCATION_CHECK(LocationAcquisitionMode::Push == copy.acquisitionMode());
+    LOCATION_CHECK(LocationPublishEncoding::Packed == copy.publishEncoding());
+    LOCATION_CHECK((8 == copy.publishBatchCount()) && (60 == copy.publishBatchAge()));
+    LOCATION_CHECK((64 == copy.storeOfflineSlots()) && (2000 == copy.storeOfflineReplayInterval()));
+    LOCATION_CHECK(copy.assistance() && (90 == copy.assistanceMargin()));
+    LOCATION_CHECK(copy.reference());
+    auto policy = copy.startPolicy(LocationStartType::Warm);
+    LOCATION_CHECK((3 == policy.settlingCount) && (500 == policy.pollIntervalMs) && (60 == policy.maximumFixSeconds));
+    LOCATION_CHECK(0 == copy.startPolicy(LocationStartType::Hot).settlingCount);
+    LOCATION_CHECK((2000 == copy.rfSharingWindow()) && (3000 == copy.rfSharingGap()) && (4000 == copy.rfSharingDefer()));
+    LOCATION_CHECK((60 == copy.dutyCycleMinimum()) && (600 == copy.dutyCycleMaximum()));
+    LOCATION_CHECK(250 == copy.dutyCycleDistance());
+    LOCATION_CHECK((500 == copy.pollIntervalMinimum()) && (4000 == copy.pollIntervalMaximum()));
+    LOCATION_CHECK(1.5f == copy.pollBackoff());
+
+    // A duty cycle minimum of zero would never grow, it is raised to the floor and the maximum follows it
+    copy.dutyCycle(0, 0);
+    LOCATION_CHECK((LocationDutyMinimumFloor == copy.dutyCycleMinimum()) &&
+                   (LocationDutyMinimumFloor == copy.dutyCycleMaximum()));
+    copy.dutyCycle(0, 600);
+    LOCATION_CHECK((LocationDutyMinimumFloor == copy.dutyCycleMinimum()) && (600 == copy.dutyCycleMaximum()));
+
+    // The accuracy threshold reaches the library, a fix estimated at 3.2 m never settles against 2.5 m
+    LocationTestModem modem;
+    modem.play({
+        {0, QLOC_FIX, EPE_FIX},
+    });
+    LocationConfiguration config;
+    config.haccThreshold(2.5f).maximumFixTime(5);
+    LOCATION_CHECK(0 == modem.begin(config));
+    LocationPoint point {};
+    LOCATION_CHECK(LocationResults::TimedOut == Location.getLocation(point));
+
+    config.haccThreshold(LocationHaccDefault);
+    LOCATION_CHECK(0 == modem.begin(config));
+    LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(point));
+
+    return locationTestResult();
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include "location_parser.h"
+#include "location_test.h"
+
+namespace {
+
+constexpr uint32_t QLOC_ALL {LOCATION_QLOC_UTC | LOCATION_QLOC_LATITUDE | LOCATION_QLOC_LONGITUDE |
+                             LOCATION_QLOC_HDOP | LOCATION_QLOC_ALTITUDE | LOCATION_QLOC_FIX | LOCATION_QLOC_COG |
+                             LOCATION_QLOC_SPEED_KMPH | LOCATION_QLOC_SPEED_KNOTS | LOCATION_QLOC_DATE |
+                             LOCATION_QLOC_NSAT};
+constexpr uint32_t EPE_ALL {LOCATION_EPE_HORIZONTAL | LOCATION_EPE_VERTICAL | LOCATION_EPE_SPEED |
+                            LOCATION_EPE_HEADING};
+
+// Parse a whole string, checking how many characters were consumed
+bool fixed(const char* str, int decimals, int32_t expected, size_t consumed) {
+    auto p = str;
+    int32_t value = 0;
+    auto ok = LocationParser::parseFixed(p, decimals, value) && (expected == value) &&
+              (consumed == (size_t)(p - str));
+    if (!ok) {
+        fprintf(stderr, "parseFixed(\"%s\", %d) gave %ld after %u characters\n", str, decimals, (long)value,
+                (unsigned int)(p - str));
+    }
+    return ok;
+}
+
+bool noFixed(const char* str) {
+    auto p = str;
+    int32_t value = 12345;
+    return !LocationParser::parseFixed(p, 3, value) && (str == p) && (12345 == value);
+}
+
+} // anonymous namespace
+
+int main() {
+    // Fixed point values keep the requested decimals, padding or rounding the fraction
+    LOCATION_CHECK(fixed("12.5", 3, 12500, 4));
+    LOCATION_CHECK(fixed("+12.5", 3, 12500, 5));
+    LOCATION_CHECK(fixed("-122.40641", 7, -1224064100, 10));
+    LOCATION_CHECK(fixed("-0.001", 3, -1, 6));
+    LOCATION_CHECK(fixed(".5", 2, 50, 2));
+    LOCATION_CHECK(fixed("7.", 1, 70, 2));
+    LOCATION_CHECK(fixed("38,", 1, 380, 2));
+
+    // The first dropped digit rounds half away from zero, carrying into the whole part, and later digits are ignored
+    LOCATION_CHECK(fixed("1.23456784", 7, 12345678, 10));
+    LOCATION_CHECK(fixed("1.23456785", 7, 12345679, 10));
+    LOCATION_CHECK(fixed("1.234567849", 7, 12345678, 11));
+    LOCATION_CHECK(fixed("-1.23456785", 7, -12345679, 11));
+    LOCATION_CHECK(fixed("0.9999999999", 7, 10000000, 12));
+    LOCATION_CHECK(fixed("2.5", 0, 3, 3));
+
+    // Values beyond the range of int32_t saturate with their sign
+    LOCATION_CHECK(fixed("2147483647", 0, INT32_MAX, 10));
+    LOCATION_CHECK(fixed("2147483648", 0, INT32_MAX, 10));
+    LOCATION_CHECK(fixed("-99999999999999", 0, -INT32_MAX, 15));
+    LOCATION_CHECK(fixed("180.0000000", 7, 1800000000, 11));
+    LOCATION_CHECK(fixed("360.0000000", 7, INT32_MAX, 11));
+    LOCATION_CHECK(fixed("214748.36475", 4, INT32_MAX, 12));
+
+    // Without digits nothing is parsed or written
+    LOCATION_CHECK(noFixed(""));
+    LOCATION_CHECK(noFixed(","));
+    LOCATION_CHECK(noFixed("-"));
+    LOCATION_CHECK(noFixed("."));
+    LOCATION_CHECK(noFixed("-.,"));
+    LOCATION_CHECK(noFixed("N"));
+
+    const char* p = "0912345";
+    uint32_t value = 0;
+    LOCATION_CHECK(LocationParser::parseUnsigned(p, 2, value) && (9 == value) && ('1' == *p));
+    LOCATION_CHECK(LocationParser::parseUnsigned(p, 0, value) && (12345 == value) && ('\0' == *p));
+    LOCATION_CHECK(!LocationParser::parseUnsigned(p, 0, value) && (12345 == value));
+
+    // A complete response, in the southern and western hemispheres
+    LocationQloc qloc;
+    LOCATION_CHECK(0 == LocationParser::parseQloc(
+        "+QGPSLOC: 003259.250,-33.86882,-151.20929,0.9,-38.4,3,095.47,41.2,22.2,010624,10\r\n", qloc));
+    LOCATION_CHECK(QLOC_ALL == qloc.present);
+    LOCATION_CHECK((0 == qloc.hour) && (32 == qloc.minute) && (59 == qloc.second) && (250 == qloc.millisecond));
+    LOCATION_CHECK((-338688200 == qloc.latitude) && (-1512092900 == qloc.longitude));
+    LOCATION_CHECK((90 == qloc.hdop) && (-38400 == qloc.altitude) && (3 == qloc.fix));
+    LOCATION_CHECK((95 == qloc.cogDegrees) && (47 == qloc.cogMinutes));
+    LOCATION_CHECK((4120 == qloc.speedKmph) && (2220 == qloc.speedKnots));
+    LOCATION_CHECK((1 == qloc.day) && (6 == qloc.month) && (24 == qloc.year) && (10 == qloc.nsat));
+
+    // Empty and malformed fields are left cleared and reported missing, the rest are still read
+    LOCATION_CHECK(0 == LocationParser::parseQloc("+QGPSLOC: ,37.78583,,1.3,12.2x,,218.21,,0.0,2105,09", qloc));
+    LOCATION_CHECK((LOCATION_QLOC_LATITUDE | LOCATION_QLOC_HDOP | LOCATION_QLOC_COG | LOCATION_QLOC_SPEED_KNOTS |
+                    LOCATION_QLOC_NSAT) == qloc.present);
+    LOCATION_CHECK((377858300 == qloc.latitude) && (0 == qloc.longitude) && (0 == qloc.altitude));
+    LOCATION_CHECK((0 == qloc.day) && (9 == qloc.nsat));
+
+    // A response cut short keeps the fields before the cut
+    LOCATION_CHECK(0 == LocationParser::parseQloc("+QGPSLOC: 170411.000,37.78583", qloc));
+    LOCATION_CHECK((LOCATION_QLOC_UTC | LOCATION_QLOC_LATITUDE) == qloc.present);
+
+    // Other lines are refused and leave nothing behind
+    LOCATION_CHECK(0 != LocationParser::parseQloc("+CME ERROR: 516", qloc));
+    LOCATION_CHECK(0 == qloc.present);
+    LOCATION_CHECK(0 != LocationParser::parseQloc("", qloc));
+    LOCATION_CHECK(0 != LocationParser::parseQloc(nullptr, qloc));
+
+    // Estimated errors are kept in thousandths
+    LocationEpe epe;
+    LOCATION_CHECK(0 == LocationParser::parseEpe(R"(+QGPSCFG: "estimation_error",3.2,4.8,0.1,1.9)", epe));
+    LOCATION_CHECK(EPE_ALL == epe.present);
+    LOCATION_CHECK((3200 == epe.horizontal) && (4800 == epe.vertical) && (100 == epe.speed) && (1900 == epe.heading));
+    LOCATION_CHECK(0 == LocationParser::parseEpe(R"( +QGPSCFG: "estimation_error",,12.0005)", epe));
+    LOCATION_CHECK((LOCATION_EPE_VERTICAL == epe.present) && (0 == epe.horizontal) && (12001 == epe.vertical));
+    LOCATION_CHECK(0 != LocationParser::parseEpe(R"(+QGPSCFG: "nmeasrc",1)", epe));
+    LOCATION_CHECK(0 != LocationParser::parseEpe("+CME ERROR: 516", epe));
+    LOCATION_CHECK(0 == epe.present);
+
+    // CME errors only in numeric format
+    uint32_t code = 0;
+    LOCATION_CHECK((0 == LocationParser::parseCmeError("+CME ERROR: 516", code)) && (516 == code));
+    LOCATION_CHECK((0 == LocationParser::parseCmeError("\r\n+CME ERROR:505\r\n", code)) && (505 == code));
+    LOCATION_CHECK(0 != LocationParser::parseCmeError("+CME ERROR: Session is ongoing", code));
+    LOCATION_CHECK(0 != LocationParser::parseCmeError("+CME ERROR: ", code));
+    LOCATION_CHECK(0 != LocationParser::parseCmeError("ERROR", code));
+    LOCATION_CHECK(0 != LocationParser::parseCmeError("", code));
+    LOCATION_CHECK(505 == code);
+
+    return locationTestResult();
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include "location_test.h"
+
+namespace {
+
+// 41.2 km/h is 11.44 m/s
+const char* const QLOC_MOVING = "+QGPSLOC: 003259.000,-33.86882,151.20929,0.8,38.9,3,095.47,41.2,22.2,010624,14";
+const char* const EPE_MOVING = R"(+QGPSCFG: "estimation_error",12.5,18.0,0.6,7.4)";
+
+std::string lastName;
+std::string lastData;
+
+} // anonymous namespace
+
+// Publishes polled fixes in both encodings and checks the speed that reaches the cloud
+int main() {
+    LocationTestModem modem;
+    modem.play({
+        {0, QLOC_MOVING, EPE_MOVING},
+    });
+
+    particle::host::onPublish([](const char* name, const char* data) {
+        lastName = name;
+        lastData = data;
+        return true;
+    });
+
+    LocationConfiguration config;
+    LOCATION_CHECK(0 == modem.begin(config));
+    LocationPoint point {};
+    LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(point, true));
+    LOCATION_CHECK((11.43f < point.speed) && (11.45f > point.speed));
+    LOCATION_CHECK("loc" == lastName);
+    LOCATION_CHECK(std::string::npos != lastData.find(R"("spd":11.44,)"));
+
+    config.publishEncoding(LocationPublishEncoding::Packed);
+    LOCATION_CHECK(0 == modem.begin(config));
+    LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(point, true));
+    LOCATION_CHECK("locb" == lastName);
+
+    uint8_t record[64];
+    auto len = LocationEncoder::base64Decode(lastData.c_str(), lastData.size(), record, sizeof(record));
+    LocationPackedFix fix {};
+    LOCATION_CHECK((0 < len) && (0 == LocationEncoder::unpack(record, (size_t)len, fix)));
+    LOCATION_CHECK(1144 == fix.speed);
+    LOCATION_CHECK(9578 == fix.heading);  // Course is reported as degrees and minutes
+
+    return locationTestResult();
+}
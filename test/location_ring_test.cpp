@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "location_ring.h"
+#include "location_test.h"
+
+namespace {
+
+// Every word holds the sequence number of the record, so a copy mixing two records is easy to spot
+struct Record {
+    uint32_t word[16];
+};
+
+constexpr uint32_t CONCURRENT_RECORDS {2000000};
+constexpr unsigned int CONCURRENT_READERS {3};
+
+Record makeRecord(uint32_t sequence) {
+    Record record;
+    for (auto& word : record.word) {
+        word = sequence;
+    }
+    return record;
+}
+
+bool isWhole(const Record& record) {
+    for (auto word : record.word) {
+        if (word != record.word[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Counts of what a reader saw
+struct ReaderResult {
+    uint32_t read {};
+    uint32_t torn {};
+    uint32_t misordered {};
+    LocationRingCursor cursor {};
+};
+
+template <size_t N>
+void readRecord(const LocationRing<Record, N>& ring, ReaderResult& result) {
+    Record record;
+    if (!ring.read(result.cursor, record)) {
+        return;
+    }
+    result.read++;
+    if (!isWhole(record)) {
+        result.torn++;
+    }
+    // The record read is always the one just before the cursor, and sequences only increase
+    if (record.word[0] + 1 != result.cursor.next) {
+        result.misordered++;
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    // A new cursor only sees later records, a backlog cursor sees what the ring still holds
+    static LocationRing<Record, 8> ring;
+    auto latest = ring.cursor();
+    auto backlog = ring.cursor(true);
+    Record record;
+    LOCATION_CHECK(!ring.read(latest, record) && !ring.read(backlog, record));
+    for (uint32_t i = 0; i < 3; i++) {
+        ring.push(makeRecord(i));
+    }
+    LOCATION_CHECK(ring.read(latest, record) && (0 == record.word[0]));
+    LOCATION_CHECK(0 == latest.overruns);
+
+    // A reader lapped by the writer skips to the oldest record held and counts what it lost
+    for (uint32_t i = 3; i < 21; i++) {
+        ring.push(makeRecord(i));
+    }
+    LOCATION_CHECK(21 == ring.written());
+    for (uint32_t i = 13; i < 21; i++) {
+        LOCATION_CHECK(ring.read(latest, record) && isWhole(record) && (i == record.word[0]));
+    }
+    LOCATION_CHECK(!ring.read(latest, record));
+    LOCATION_CHECK(12 == latest.overruns);
+    LOCATION_CHECK(21 == latest.next);
+
+    // Other readers are unaffected by it
+    backlog = ring.cursor(true);
+    LOCATION_CHECK(13 == backlog.next);
+    LOCATION_CHECK(ring.read(backlog, record) && (13 == record.word[0]) && (0 == backlog.overruns));
+
+    // One writer and several readers on their own threads, with a ring small enough that the writer keeps lapping
+    // them.  No reader may see a torn record or one out of order, and every record is either read or counted as an
+    // overrun.
+    static LocationRing<Record, 4> small;
+    std::vector<ReaderResult> results(CONCURRENT_READERS);
+    std::atomic<bool> done {false};
+    std::vector<std::thread> readers;
+    for (auto& result : results) {
+        result.cursor = small.cursor(true);
+        readers.emplace_back([&result, &done]() {
+            while (!done.load()) {
+                readRecord(small, result);
+            }
+            while (result.cursor.next != small.written()) {
+                readRecord(small, result);
+            }
+        });
+    }
+    std::thread writer([]() {
+        for (uint32_t i = 0; i < CONCURRENT_RECORDS; i++) {
+            small.push(makeRecord(i));
+        }
+    });
+    writer.join();
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    for (auto& result : results) {
+        LOCATION_CHECK(0 == result.torn);
+        LOCATION_CHECK(0 == result.misordered);
+        LOCATION_CHECK(CONCURRENT_RECORDS == result.read + result.cursor.overruns);
+        LOCATION_CHECK(CONCURRENT_RECORDS == result.cursor.next);
+    }
+
+    return locationTestResult();
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+
+#include "location_stats.h"
+#include "location_test.h"
+
+namespace {
+
+const char* const QLOC = "+QGPSLOC: 170411.000,37.78583,-122.40641,1.3,12.2,3,218.21,0.0,0.0,210524,09";
+const char* const EPE = R"(+QGPSCFG: "estimation_error",3.2,4.8,0.1,1.9)";
+
+// Passes commands to a simulated modem but hands CME errors over as information responses
+class PlusCmeModem : public LocationModem {
+public:
+    explicit PlusCmeModem(LocationModem& modem) : _modem(modem) {}
+
+    bool isOn() override {
+        return _modem.isOn();
+    }
+
+    LocationModemDevice device() override {
+        return _modem.device();
+    }
+
+    int command(LocationModemCallback callback, void* param, uint32_t timeoutMs, const char* command) override {
+        Forward forward {callback, param};
+        return _modem.command(relay, &forward, timeoutMs, command);
+    }
+
+    int addUrcHandler(const char* prefix, LocationModemUrcCallback callback, void* param) override {
+        return _modem.addUrcHandler(prefix, callback, param);
+    }
+
+private:
+    struct Forward {
+        LocationModemCallback callback;
+        void* param;
+    };
+
+    static void relay(LocationModemResponse type, const char* buf, int len, void* param) {
+        auto forward = static_cast<Forward*>(param);
+        if ((LocationModemResponse::Error == type) && strstr(buf, "+CME ERROR:")) {
+            type = LocationModemResponse::Plus;
+        }
+        if (forward->callback) {
+            forward->callback(type, buf, len, forward->param);
+        }
+    }
+
+    LocationModem& _modem;
+};
+
+uint32_t total(const uint32_t* counters, size_t count) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += counters[i];
+    }
+    return sum;
+}
+
+// Check the counters of the position polls of a session that fixes after two seconds of CME 516 responses
+bool checkPolls(const LocationAtStatistics& stats) {
+    auto& poll = stats.command[(size_t)LocationAtCommand::Poll];
+    auto noFix = poll.cme[LocationAtStats::cmeIndex(516)];
+    auto ok = LOCATION_CHECK(0 < noFix);
+    ok &= LOCATION_CHECK(noFix == total(poll.cme, LocationCmeCounters));
+    ok &= LOCATION_CHECK(noFix == poll.errors);
+    ok &= LOCATION_CHECK(noFix < poll.count);
+    ok &= LOCATION_CHECK(poll.count == total(poll.latency, LocationLatencyBuckets));
+    auto& start = stats.command[(size_t)LocationAtCommand::Start];
+    ok &= LOCATION_CHECK((1 == start.count) && (0 == start.errors));
+    return ok;
+}
+
+} // anonymous namespace
+
+int main() {
+    // Latency buckets double from 1 ms and the last one is open ended
+    LOCATION_CHECK(0 == LocationAtStats::bucket(0));
+    LOCATION_CHECK(1 == LocationAtStats::bucket(1));
+    LOCATION_CHECK(2 == LocationAtStats::bucket(2));
+    LOCATION_CHECK(2 == LocationAtStats::bucket(3));
+    LOCATION_CHECK(10 == LocationAtStats::bucket(1000));
+    LOCATION_CHECK(LocationLatencyBuckets - 1 == LocationAtStats::bucket(1u << (LocationLatencyBuckets - 2)));
+    LOCATION_CHECK(LocationLatencyBuckets - 1 == LocationAtStats::bucket(UINT32_MAX));
+
+    // Known CME codes have their own counters, every other code shares the last one
+    for (size_t i = 0; i < LocationCmeCounters - 1; i++) {
+        LOCATION_CHECK(i == LocationAtStats::cmeIndex(LocationCmeCodes[i]));
+    }
+    LOCATION_CHECK(LocationCmeCounters - 1 == LocationAtStats::cmeIndex(0));
+    LOCATION_CHECK(LocationCmeCounters - 1 == LocationAtStats::cmeIndex(999));
+
+    static LocationAtStats counters;
+    counters.record(LocationAtCommand::Configure, 0, true);
+    counters.record(LocationAtCommand::Configure, 300, false);
+    counters.record(LocationAtCommand::Configure, 300, true);
+    counters.recordCme(LocationAtCommand::Configure, 549);
+    counters.recordCme(LocationAtCommand::Configure, 3);
+    LocationAtStatistics stats {};
+    counters.snapshot(stats);
+    auto& configure = stats.command[(size_t)LocationAtCommand::Configure];
+    LOCATION_CHECK((3 == configure.count) && (1 == configure.errors));
+    LOCATION_CHECK((1 == configure.latency[0]) && (2 == configure.latency[9]));
+    LOCATION_CHECK(3 == total(configure.latency, LocationLatencyBuckets));
+    LOCATION_CHECK((1 == configure.cme[5]) && (1 == configure.cme[LocationCmeCounters - 1]));
+    LOCATION_CHECK(0 == stats.command[(size_t)LocationAtCommand::Start].count);
+    counters.reset();
+    counters.snapshot(stats);
+    LOCATION_CHECK((0 == configure.count) && (0 == configure.errors));
+    LOCATION_CHECK((0 == total(configure.latency, LocationLatencyBuckets)) &&
+                   (0 == total(configure.cme, LocationCmeCounters)));
+
+    // The library counts CME errors reported as final errors
+    LocationTestModem modem;
+    LocationConfiguration config;
+    LocationPoint point;
+    modem.play({
+        {0, nullptr, nullptr},
+        {2000, QLOC, EPE},
+    });
+    LOCATION_CHECK(0 == modem.begin(config));
+    Location.resetStatistics();
+    LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(point));
+    Location.getStatistics(stats);
+    checkPolls(stats);
+
+    // And the same errors handed over as information responses
+    PlusCmeModem plus(modem.modem());
+    LOCATION_CHECK(0 == Location.begin(config, plus));
+    Location.resetStatistics();
+    LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(point));
+    Location.getStatistics(stats);
+    checkPolls(stats);
+
+    // Give the library back the modem the helper owns before the wrapper goes away
+    LOCATION_CHECK(0 == modem.begin(config));
+
+    return locationTestResult();
+}
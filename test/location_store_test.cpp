@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "location_store.h"
+#include "location_test.h"
+
+namespace {
+
+const char* const QLOC_1 = "+QGPSLOC: 170411.000,37.78583,-122.40641,1.3,12.2,3,218.21,0.0,0.0,210524,09";
+const char* const QLOC_2 = "+QGPSLOC: 170511.000,37.78683,-122.40641,1.3,12.2,3,000.00,4.0,2.2,210524,09";
+const char* const QLOC_3 = "+QGPSLOC: 170611.000,37.78783,-122.40641,1.3,12.2,3,000.00,4.0,2.2,210524,09";
+const char* const EPE = R"(+QGPSCFG: "estimation_error",3.2,4.8,0.1,1.9)";
+
+constexpr size_t RECORD_SIZE {4 + LocationEncoder::PackedSize + 1};
+
+LocationPackedFix testFix(uint32_t n) {
+    LocationPackedFix fix {};
+    fix.reqId = n;
+    fix.locked = true;
+    fix.epochTime = 1716311051 + n;
+    fix.latitude = 377858300 + (int32_t)n;
+    fix.longitude = -1224064100 - (int32_t)n;
+    return fix;
+}
+
+void segmentPath(const char* directory, uint32_t segment, char* path, size_t size) {
+    snprintf(path, size, "%s/f%08lx", directory, (unsigned long)segment);
+}
+
+size_t segmentFiles(const char* directory) {
+    size_t count = 0;
+    auto dir = opendir(directory);
+    while (auto entry = readdir(dir)) {
+        count += ('f' == entry->d_name[0]) ? 1 : 0;
+    }
+    closedir(dir);
+    return count;
+}
+
+void removeDirectory(const char* directory) {
+    auto dir = opendir(directory);
+    if (!dir) {
+        return;
+    }
+    while (auto entry = readdir(dir)) {
+        if ('.' != entry->d_name[0]) {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+            unlink(path);
+        }
+    }
+    closedir(dir);
+    rmdir(directory);
+}
+
+// Replay every pending fix, checking that they come out in order from the first one expected
+size_t replayAll(LocationStore& store, uint32_t first, uint32_t skipped = 0xffffffff) {
+    size_t replayed = 0;
+    LocationPackedFix fix;
+    auto expected = first;
+    while (0 == store.peek(fix)) {
+        if (expected == skipped) {
+            expected++;
+        }
+        LOCATION_CHECK(expected == fix.reqId);
+        LOCATION_CHECK((1716311051 + expected) == fix.epochTime);
+        LOCATION_CHECK((-1224064100 - (int32_t)expected) == fix.longitude);
+        store.pop();
+        expected++;
+        replayed++;
+    }
+    return replayed;
+}
+
+} // anonymous namespace
+
+int main() {
+    char directory[] = "/tmp/location_store_XXXXXX";
+    if (!LOCATION_CHECK(mkdtemp(directory))) {
+        return locationTestResult();
+    }
+    char path[128];
+
+    // A new log is empty
+    LocationStore store;
+    LOCATION_CHECK(0 == store.begin(directory, 100));
+    LOCATION_CHECK(store.isOpen());
+    LOCATION_CHECK(0 == store.pending());
+    LocationPackedFix fix;
+    LOCATION_CHECK(0 != store.peek(fix));
+
+    // Head and tail are found again after reopening, with the committed replay position
+    for (uint32_t i = 0; i < 10; i++) {
+        LOCATION_CHECK(0 == store.append(testFix(i)));
+    }
+    store.end();
+    LOCATION_CHECK(!store.isOpen());
+    LOCATION_CHECK(0 == store.begin(directory, 100));
+    LOCATION_CHECK(10 == store.pending());
+    for (int i = 0; i < 3; i++) {
+        LOCATION_CHECK(0 == store.peek(fix));
+        store.pop();
+    }
+    LOCATION_CHECK(0 == store.commit());
+    store.end();
+    LOCATION_CHECK(0 == store.begin(directory, 100));
+    LOCATION_CHECK(7 == store.pending());
+    LOCATION_CHECK((0 == store.peek(fix)) && (3 == fix.reqId));
+
+    // A record torn by a reset during its write is cut off, and appends continue in line after it
+    store.end();
+    segmentPath(directory, 0, path, sizeof(path));
+    auto fd = open(path, O_WRONLY | O_APPEND);
+    const uint8_t torn[RECORD_SIZE / 2] = {10, 0, 0, 0, LocationEncoder::PackedVersion};
+    LOCATION_CHECK((ssize_t)sizeof(torn) == write(fd, torn, sizeof(torn)));
+    close(fd);
+    LOCATION_CHECK(0 == store.begin(directory, 100));
+    LOCATION_CHECK(7 == store.pending());
+    LOCATION_CHECK(0 == store.append(testFix(10)));
+    store.end();
+    struct stat st = {};
+    LOCATION_CHECK((0 == stat(path, &st)) && (11 * RECORD_SIZE == (size_t)st.st_size));
+    LOCATION_CHECK(0 == store.begin(directory, 100));
+    LOCATION_CHECK(8 == replayAll(store, 3));
+    LOCATION_CHECK(0 == store.pending());
+
+    // A record corrupted after it was written is skipped
+    for (uint32_t i = 11; i < 20; i++) {
+        LOCATION_CHECK(0 == store.append(testFix(i)));
+    }
+    store.end();
+    fd = open(path, O_RDWR);
+    uint8_t byte = 0;
+    auto offset = (off_t)(15 * RECORD_SIZE + 20);
+    LOCATION_CHECK((1 == pread(fd, &byte, 1, offset)));
+    byte ^= 0x40;
+    LOCATION_CHECK((1 == pwrite(fd, &byte, 1, offset)));
+    close(fd);
+    LOCATION_CHECK(0 == store.begin(directory, 100));
+    LOCATION_CHECK(9 == store.pending());
+    LOCATION_CHECK(8 == replayAll(store, 11, 15));
+    store.commit();
+
+    // Past its capacity the log deletes whole segments, oldest first, and counts the fixes lost
+    auto segments = (100 + LocationStore::SegmentRecords - 1) / LocationStore::SegmentRecords + 1;
+    for (uint32_t i = 20; i < 20 + 5 * LocationStore::SegmentRecords; i++) {
+        LOCATION_CHECK(0 == store.append(testFix(i)));
+    }
+    LOCATION_CHECK(segments == segmentFiles(directory));
+    auto head = 20 + 5 * LocationStore::SegmentRecords;
+    auto first = (uint32_t)((head / LocationStore::SegmentRecords - segments + 1) * LocationStore::SegmentRecords);
+    LOCATION_CHECK(head - first == store.pending());
+    LOCATION_CHECK(first - 20 == store.overwritten());
+    LOCATION_CHECK(100 <= store.pending());
+
+    // Replay runs across segments in order, and resumes in order after a reset part way
+    for (int i = 0; i < 70; i++) {
+        LOCATION_CHECK(0 == store.peek(fix));
+        LOCATION_CHECK(first + i == fix.reqId);
+        store.pop();
+    }
+    store.end();
+    LOCATION_CHECK(0 == store.begin(directory, 100));
+    LOCATION_CHECK(head - first - 70 == replayAll(store, first + 70));
+
+    // Reducing the capacity drops the oldest segments when the log is opened
+    for (uint32_t i = head; i < head + 3 * LocationStore::SegmentRecords; i++) {
+        LOCATION_CHECK(0 == store.append(testFix(i)));
+    }
+    store.end();
+    LOCATION_CHECK(0 == store.begin(directory, 10));
+    LOCATION_CHECK(2 == segmentFiles(directory));
+    LOCATION_CHECK(LocationStore::SegmentRecords < store.pending());
+    store.end();
+
+    removeDirectory(directory);
+
+    // Fixes acquired while offline are replayed by the library once connected, oldest first
+    removeDirectory(LOCATION_STORE_DIRECTORY);
+    std::vector<LocationPackedFix> replayed;
+    particle::host::onPublish([&replayed](const char* name, const char* data) {
+        uint8_t record[LocationEncoder::PackedSize];
+        LocationPackedFix fix {};
+        auto len = LocationEncoder::base64Decode(data, strlen(data), record, sizeof(record));
+        if (LOCATION_CHECK((0 == strcmp("locb", name)) && (0 < len) && !LocationEncoder::unpack(record, len, fix))) {
+            replayed.push_back(fix);
+        }
+        return true;
+    });
+    particle::host::connected(false);
+
+    LocationTestModem modem;
+    LocationConfiguration config;
+    config.storeOffline(100, 2000);
+    LOCATION_CHECK(0 == modem.begin(config));
+    LocationPoint point;
+    for (auto qloc : {QLOC_1, QLOC_2, QLOC_3}) {
+        modem.play({
+            {0, qloc, EPE},
+        });
+        LOCATION_CHECK(LocationResults::Fixed == Location.getLocation(point, true));
+    }
+    LOCATION_CHECK(replayed.empty());
+
+    particle::host::connected(true);
+    auto start = System.millis();
+    while ((3 > replayed.size()) && ((System.millis() - start) < 60 * 1000)) {
+        delay(100);
+    }
+    LOCATION_CHECK(3 == replayed.size());
+    if (3 == replayed.size()) {
+        LOCATION_CHECK((1716311051 == replayed[0].epochTime) && (377858300 == replayed[0].latitude));
+        LOCATION_CHECK((1716311111 == replayed[1].epochTime) && (377868300 == replayed[1].latitude));
+        LOCATION_CHECK((1716311171 == replayed[2].epochTime) && (377878300 == replayed[2].latitude));
+        LOCATION_CHECK(replayed[0].reqId == replayed[2].reqId);  // Nothing was published in between
+        LOCATION_CHECK(4000 <= System.millis() - start);
+    }
+    particle::host::onPublish(nullptr);
+
+    return locationTestResult();
+}
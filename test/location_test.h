@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <initializer_list>
+#include <thread>
+#include <vector>
+
+#include "Particle.h"
+#include "location.h"
+#include "location_modem_sim.h"
+
+/**
+ * @brief Minimal checks for the host tests, each test is a program that exits non-zero on failure
+ *
+ */
+#define LOCATION_CHECK(condition) locationCheck((condition), #condition, __FILE__, __LINE__)
+
+inline int& locationFailures() {
+    static int failures {};
+    return failures;
+}
+
+inline bool locationCheck(bool passed, const char* condition, const char* file, int line) {
+    if (!passed) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+        locationFailures()++;
+    }
+    return passed;
+}
+
+inline int locationTestResult() {
+    if (locationFailures()) {
+        fprintf(stderr, "%d checks failed\n", locationFailures());
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Simulated BG95 given to the library for the duration of a test
+ *
+ * The location thread keeps using the modem given to begin() until the process exits, so the destructor hands the
+ * library back its cellular modem before the simulated one goes away.  NMEA output delivered as URCs is pumped by a
+ * thread of its own, as a modem would deliver it independently of the commands sent by the library.
+ *
+ */
+class LocationTestModem {
+public:
+    LocationTestModem() : _modem(clock) {
+    }
+
+    ~LocationTestModem() {
+        _stop.store(true);
+        if (_pump.joinable()) {
+            _pump.join();
+        }
+        LocationConfiguration config;
+        Location.begin(config, Location.cellularModem());
+    }
+
+    LocationTestModem(const LocationTestModem&) = delete;
+    LocationTestModem& operator=(const LocationTestModem&) = delete;
+
+    /**
+     * @brief Set the steps played by the next sessions
+     *
+     * @param steps Steps in increasing time order, the strings they point to must remain valid while in use
+     */
+    void play(std::initializer_list<LocationSimulatedStep> steps) {
+        _steps = steps;
+        _scenario = {"test", _steps.data(), _steps.size()};
+        _modem.scenario(_scenario);
+    }
+
+    /**
+     * @brief Begin the library with the simulated modem
+     *
+     * @param config Configuration given to SomLocation::begin()
+     * @return int Result of SomLocation::begin()
+     */
+    int begin(LocationConfiguration& config) {
+        return Location.begin(config, _modem);
+    }
+
+    /**
+     * @brief Deliver the NMEA sentences of the steps as URCs, unlike the BG95
+     *
+     */
+    void nmeaUrcs() {
+        _modem.nmeaUrcs(true);
+        if (!_pump.joinable()) {
+            _pump = std::thread([this]() {
+                while (!_stop.load()) {
+                    _modem.deliverUrcs();
+                    delay(100);
+                }
+            });
+        }
+    }
+
+    LocationSimulatedModem& modem() {
+        return _modem;
+    }
+
+private:
+    static uint64_t clock() {
+        return System.millis();
+    }
+
+    LocationSimulatedModem _modem;
+    std::vector<LocationSimulatedStep> _steps;
+    LocationSimulatedScenario _scenario {};
+    std::thread _pump;
+    std::atomic<bool> _stop {false};
+};
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024 Particle Industries, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ctime>
+
+#include "location_test.h"
+#include "location_time.h"
+
+// Check every day from 2000 to 2099 against timegm(), which is UTC regardless of the host time zone
+int main() {
+    for (int32_t year = 2000; year <= 2099; year++) {
+        for (unsigned int month = 1; month <= 12; month++) {
+            for (unsigned int day = 1; day <= 31; day++) {
+                std::tm timeinfo = {};
+                timeinfo.tm_year = year - 1900;
+                timeinfo.tm_mon = month - 1;
+                timeinfo.tm_mday = day;
+                auto midnight = timegm(&timeinfo);
+                if ((int)month != timeinfo.tm_mon + 1) {
+                    continue;  // Day does not exist in this month
+                }
+
+                if (!LOCATION_CHECK(midnight == LocationTime::epochFromUtc(year, month, day, 0, 0, 0)) ||
+                    !LOCATION_CHECK(midnight + 86399 == LocationTime::epochFromUtc(year, month, day, 23, 59, 59)) ||
+                    !LOCATION_CHECK(midnight / 86400 == LocationTime::daysFromCivil(year, month, day))) {
+                    fprintf(stderr, "mismatch for %04d-%02u-%02u\n", (int)year, month, day);
+                    return locationTestResult();
+                }
+            }
+        }
+    }
+
+    return locationTestResult();
+}